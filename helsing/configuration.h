@@ -112,10 +112,13 @@
  * The included algorithms:
  * 1) normal
  * 2) cache
+ * 3) swar
+ * 4) bits
  *
  * They can be toggled individually.
  * When more than one algorithms are enabled, the results have to satisfy only
- * one of them.
+ * one of them. ALG_BITS and ALG_SWAR replace the other algorithms where they
+ * apply, see below.
  */
 
 #define ALG_NORMAL false
@@ -211,6 +214,72 @@
 	#if (ALG_NORMAL && ALG_CACHE)
 		#warning both ALG_NORMAL and ALG_CACHE are enabled -- performance will suffer
 	#endif
+
+/*
+ * ALG_SWAR:
+ *
+ * 	Table-free alternative to ALG_CACHE for long numbers. Past 20 or so digits
+ * the dig[] array of ALG_CACHE no longer fits in any level of cache and most
+ * of the time is spent waiting for memory.
+ *
+ * 	ALG_SWAR keeps the multiplicand and the product as vectors of digits packed
+ * in 64-bit words, 4 bits per digit up to BASE 16 and 8 bits above that. Both
+ * vectors are iterated with SIMD within a register (SWAR) additions in BASE,
+ * and the digits are counted in place with lane-wise compares. Nothing is
+ * loaded from memory.
+ *
+ * SWAR_MIN_LENGTH:
+ * 	Products with at least SWAR_MIN_LENGTH digits are checked with ALG_SWAR,
+ * shorter ones with ALG_NORMAL/ALG_CACHE. If ALG_SWAR is the only algorithm
+ * enabled, it checks every length.
+ *
+ * 	scripts/swar/compare.sh measures both algorithms for each length, use it
+ * to find the crossover point of your machine.
+ */
+
+#define ALG_SWAR false
+#define SWAR_MIN_LENGTH 20
+	#if (SWAR_MIN_LENGTH < 2)
+		#error SWAR_MIN_LENGTH must be at least 2
+	#endif
+
+/*
+ * ALG_BITS:
+ *
+ * 	Arithmetic digit counting for power-of-two bases (2, 4, 8, 16...). In
+ * these bases every digit is a group of log2(BASE) bits of the number itself,
+ * so there is nothing to convert or look up: the digits equal to d are found
+ * by matching the bits of d in every group, and counted with popcount.
+ *
+ * 	Before counting individual digits, the amount of digits that have each bit
+ * set is compared. In BASE 2 this is the complete check.
+ *
+ * 	It only pays off where ALG_CACHE has to double check its results.
+ * Elsewhere the dig[] array fits in the L1 cache and a lookup is cheaper than
+ * counting. The counting also needs a popcount instruction (-mpopcnt or
+ * -march=native), without one it loses everywhere but BASE 64. One thread,
+ * best of three, ALG_CACHE -> ALG_BITS:
+ *
+ * 	BASE  -n   -O2              -O2 -mpopcnt
+ * 	2     36   56.1s -> 57.6s   56.1s -> 54.6s
+ * 	4     18   22.3s -> 35.8s   19.3s -> 17.9s
+ * 	8     12   10.6s -> 29.0s    9.5s -> 11.1s
+ * 	16    8     0.32s -> 1.09s   0.31s -> 0.49s
+ * 	32    6     0.11s -> 0.35s   0.11s -> 0.17s
+ * 	64    6    17.3s -> 4.4s    14.2s -> 2.3s
+ *
+ * 	So ALG_BITS is only used in BASE 2 and 4 when the compiler targets a
+ * popcount instruction, and in BASE 64. In the other bases it has no effect
+ * and ALG_CACHE is used instead. Where it's used, it checks every length and
+ * the dig[] array of ALG_CACHE is not built. --buildconf shows whether it's
+ * used, as ALG_BITS_ACTIVE.
+ *
+ * 	It's off by default, since it's only faster in bases that are rarely
+ * searched.
+ */
+
+#define ALG_BITS false
+
 /*
  * BASE:
  *
@@ -250,10 +319,112 @@
  * Quicksort shouldn't use more memory than:
  * threads * (sizeof(array) + MAX_TASK_SIZE * sizeof(vamp_t) * max(n_fang_pairs))
  * See https://oeis.org/A094208 for max(n_fang_pairs).
+ *
+ * 	With --max-memory it caps the cells instead, see MEMORY_CELLS.
  */
 
 #define MAX_TASK_SIZE 99999999999ULL
 
+/*
+ * TASKBOARD_WINDOW:
+ *
+ * 	Tasks may complete out of order, but their results are processed in
+ * order. The taskboard has TASKBOARD_WINDOW slots per thread for the tasks
+ * that are running or waiting for the ones before them, and a thread that
+ * would run past the last slot waits instead. -w sets the number of slots.
+ *
+ * REORDER_SPILL:
+ *
+ * 	-w can also limit the memory held by results that wait for the ones
+ * before them. Past the limit, complete results are moved to a temporary
+ * file and read back in order if REORDER_SPILL is true. Otherwise threads
+ * stop taking new tasks until the memory is freed.
+ */
+
+#define TASKBOARD_WINDOW 4
+#define REORDER_SPILL true
+
+/*
+ * WORK_STEALING:
+ *
+ * 	The cost of a task depends on where it lies in the interval, so with
+ * equal sized tasks one thread can be left with the last big task while the
+ * others sit idle. With WORK_STEALING every thread keeps the unprocessed
+ * part of its task in a deque, halving it before each step, and idle threads
+ * steal from the other deques. Output order is not affected.
+ *
+ * STEAL_DEPTH:
+ *
+ * 	Tasks are split down to pieces of 1/2^STEAL_DEPTH of the task size.
+ * Every piece repeats the multiplier loop of vampire(), so deeper splits
+ * cost more.
+ *
+ * SPLIT_MULTIPLIERS:
+ *
+ * 	When there's nothing left to claim or steal, idle threads take the
+ * bottom half of the multipliers that a running vampire() call hasn't
+ * reached yet. This cuts down the last task of the run, which can't be
+ * split any further by STEAL_DEPTH. Requires WORK_STEALING.
+ */
+
+#define WORK_STEALING true
+#define STEAL_DEPTH 3
+#define SPLIT_MULTIPLIERS true
+
+/*
+ * MULTIPLIER_TASKS:
+ *
+ * 	Normally a task is a range of products, and vampire() goes over every
+ * multiplier of the digit length for each of them. With MULTIPLIER_TASKS a
+ * task is a range of multipliers over the whole digit length instead, so
+ * the setup of every multiplier is done only once. Tasks are cut to equal
+ * numbers of fang pairs, see costmodel_multiplier_cut.
+ *
+ * 	Any task can find any number of the digit length, so the results are
+ * merged, printed and checkpointed only once the whole length is done. That
+ * means all the results of a digit length are held in memory at once.
+ */
+
+#define MULTIPLIER_TASKS false
+
+/*
+ * MEMORY_CELLS:
+ *
+ * 	With --max-memory, the tasks of the usual size are cut into MEMORY_CELLS
+ * cells, of MAX_TASK_SIZE at most. A thread claims as many cells as it
+ * expects to fit its share of the memory, judging by the results of the
+ * tasks of the same digit length that completed before. So tasks shrink
+ * down to a single cell where results are dense, and grow back up to the
+ * usual size where they're sparse. Until a task of the digit length has
+ * completed, a thread claims a single cell.
+ *
+ * 	Every cell takes a slot of the window, so by default the window is
+ * MEMORY_CELLS times bigger. -w still sets the number of slots, and a claim
+ * takes no more cells than are left in it.
+ */
+
+#define MEMORY_CELLS 64
+
+/*
+ * RUN_POLL:
+ *
+ * 	While a run is in progress, the threads file of --threads-file, SIGTERM
+ * and SIGINT, and --time-limit are checked every RUN_POLL seconds. The
+ * number of running threads follows the file.
+ *
+ * 	On a signal or once the time limit is up, no more tasks are handed out.
+ * With TASK_CHECKPOINT, the running tasks stop at the next block of
+ * multipliers and are saved half way; otherwise they're finished. Either
+ * way the results that are done are printed in order and checkpointed.
+ *
+ * 	The same signal again within a second is ignored, timeout(1) may send
+ * it twice. A different signal, or the same one later, stops the run at once:
+ * the results that are done are still printed and checkpointed, but the
+ * running tasks aren't waited for. One more signal ends the program.
+ */
+
+#define RUN_POLL 1
+
 /*
  * USE_CHECKPOINT:
  *
@@ -271,15 +442,62 @@
  * 	1. The code always checks if checkpoint file exists before 'touch'-ing
  * 	   it. This way we prevent accidental truncation.
  *
- * 	2. The code opens the file only in read or append mode. This way we
- * 	   avoid accidental overwrite of data.
+ * 	2. The code never truncates the file. It's written as a whole to
+ * 	   [checkpoint].tmp, which is synced to the disk and then renamed over
+ * 	   the checkpoint. A crash leaves either the old or the new file.
  *
  * 	3. The code has no ability to delete files. You'll have to do that
- * 	   manually.
+ * 	   manually. The only files that get replaced are the checkpoint and
+ * 	   [checkpoint].tasks, see TASK_CHECKPOINT.
  */
 
 #define USE_CHECKPOINT true
 
+/*
+ * CHECKPOINT_SECONDS / CHECKPOINT_TASKS:
+ *
+ * 	The checkpoint is saved once CHECKPOINT_TASKS tasks have been checked
+ * since the last save, or once CHECKPOINT_SECONDS have passed, whichever
+ * comes first, and at the end of the run, even if it's stopped early (see
+ * RUN_POLL). Only a crash or SIGKILL loses the progress since the last save.
+ * Set either one to 0 to leave it out, or both to save after every task as
+ * before.
+ */
+
+#define CHECKPOINT_SECONDS 60
+#define CHECKPOINT_TASKS 0
+
+/*
+ * CHECKPOINT_HISTORY:
+ *
+ * 	Only the header and the last line of the checkpoint are needed to
+ * resume, so the lines before the last one are dropped whenever it's saved,
+ * and a restart doesn't take longer the longer a run goes on. With
+ * CHECKPOINT_HISTORY, the last line of every digit length is kept too, as a
+ * record of the counts and the checksum up to every length.
+ */
+
+#define CHECKPOINT_HISTORY true
+
+/*
+ * TASK_CHECKPOINT:
+ *
+ * 	A checkpoint line is only written once a task and every task before
+ * it are done, so with long tasks a restart can lose hours of work. Every
+ * TASK_CHECKPOINT seconds vampire() stops at the next block of multipliers,
+ * and the multipliers it didn't reach go back to the thread's deque as a new
+ * piece. Every TASK_CHECKPOINT seconds the writer also saves the tasks after
+ * the checkpoint, with the pieces they have finished and their results, to
+ * [checkpoint].tasks, and -c picks them up half way. The tasks that
+ * completed out of order, while an earlier one was still running, are saved
+ * with their results and aren't checked again.
+ *
+ * 	Set it to 0 to turn this off. Requires WORK_STEALING, and doesn't apply
+ * to MULTIPLIER_TASKS, where a whole digit length is checkpointed at once.
+ */
+
+#define TASK_CHECKPOINT 300
+
 /*
  * LINK_SIZE:
  *
@@ -288,7 +506,6 @@
 
 #define LINK_SIZE 100
 #define LLMSENTENCE_LIMIT 10000
-#define TASKBOARD_LIMIT 1000000
 #define SAFETY_CHECKS false
 
 #endif /* HELSING_CONFIG_H */
@@ -9,6 +9,8 @@ selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
 
 "$selfdir/set.sh" ALG_NORMAL    false
 "$selfdir/set.sh" ALG_CACHE     true
+"$selfdir/set.sh" ALG_SWAR      false
+"$selfdir/set.sh" ALG_BITS      false
 "$selfdir/set.sh" SAFETY_CHECKS false
 
 if [ $# -eq 4 ]; then
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+selfname="$(basename "$0")"
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+case $# in
+	"3")
+		time="$1"
+		n_min="$2"
+		n_max="$3"
+		;;
+	*)
+		echo "Compare ALG_CACHE and ALG_SWAR for each length, and suggest SWAR_MIN_LENGTH"
+		echo "Usage: $selfname [TIME] [N_MIN] [N_MAX]"
+		echo -e "TIME                         seconds per run, see timeout.sh"
+		exit
+		;;
+esac
+
+n_seq=$(seq $(( n_min + n_min % 2 )) 2 $n_max) # [n]
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+configuration_h_backup="$tempdir/configuration.backup"
+cp configuration.h "$configuration_h_backup"
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv "$configuration_h_backup" configuration.h
+	exit
+}
+
+trap cleanup SIGINT
+
+# Numbers checked within $time seconds, for each [n]
+declare -A progress
+
+for alg in cache swar; do
+	cp "$configuration_h_backup" configuration.h
+	"$selfdir/../configuration/set_cache.sh"
+	if [ "$alg" == "swar" ]; then
+		"$selfdir/../configuration/set.sh" ALG_CACHE false
+		"$selfdir/../configuration/set.sh" ALG_SWAR true
+	fi
+	make clean > /dev/null 2>&1
+	make -j4 > /dev/null 2>&1
+
+	for n in $n_seq; do
+		complete=$("$selfdir/../timeout.sh" "$time" -n "$n" -t 1)
+		progress[$alg,$n]="${complete:-0}"
+	done
+done
+
+echo -e "n\tcache\tswar"
+suggestion=""
+for n in $n_seq; do
+	echo -e "$n\t${progress[cache,$n]}\t${progress[swar,$n]}"
+	if [ -z "$suggestion" ] && [ "${progress[swar,$n]}" -gt "${progress[cache,$n]}" ]; then
+		suggestion="$n"
+	fi
+done
+
+if [ -n "$suggestion" ]; then
+	echo "SWAR_MIN_LENGTH $suggestion"
+else
+	echo "ALG_CACHE was faster for every length"
+fi
+
+cleanup
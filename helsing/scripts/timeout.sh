@@ -11,7 +11,7 @@ shift 1
 tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
 checkpoint="$tempdir/a.checkpoint"
 
-timeout "$time" ./helsing -c "$checkpoint" $@ > /dev/null 2>&1
+timeout --foreground "$time" ./helsing -c "$checkpoint" $@ > /dev/null 2>&1
 if [ ! -f "$checkpoint" ]; then
 	echo "0"
 	exit -1
@@ -0,0 +1,395 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#if defined(__linux__)
+#include <limits.h> // PATH_MAX
+#endif
+
+#include "configuration.h"
+#include "configuration_adv.h"
+#include "helper.h"
+#include "affinity.h"
+
+static const char *affinity_names[] = {
+	[affinity_none] = "none",
+	[affinity_compact] = "compact",
+	[affinity_scatter] = "scatter",
+	[affinity_physical] = "physical"
+};
+
+int affinity_set(enum affinity *ptr, const char *str)
+{
+	for (size_t i = 0; i < sizeof(affinity_names) / sizeof(affinity_names[0]); i++) {
+		if (strcmp(str, affinity_names[i]) == 0) {
+			*ptr = i;
+			return 0;
+		}
+	}
+	fprintf(stderr, "Unknown affinity policy: %s, expected none, compact, scatter or physical\n", str);
+	return 1;
+}
+
+#if defined(__linux__)
+
+struct cpu
+{
+	int id;
+	long package;
+	long core;
+	long core_rank; // The core's position within its package
+	long smt; // The cpu's position among the SMT siblings of its core
+};
+
+static long topology_read(int cpu, const char *name)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+
+	long ret = -1;
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+		return ret;
+	if (fscanf(fp, "%ld", &ret) != 1)
+		ret = -1;
+	fclose(fp);
+	return ret;
+}
+
+static enum affinity sort_policy;
+
+static int key_compare(long a, long b)
+{
+	return ((a > b) - (a < b));
+}
+
+static int cpu_compare(const void *a, const void *b)
+{
+	const struct cpu *x = a;
+	const struct cpu *y = b;
+	int ret = 0;
+
+	switch (sort_policy) {
+		case affinity_compact:
+			if ((ret = key_compare(x->package, y->package)) == 0)
+				ret = key_compare(x->core, y->core);
+			if (ret == 0)
+				ret = key_compare(x->smt, y->smt);
+			break;
+		case affinity_physical:
+			if ((ret = key_compare(x->smt, y->smt)) == 0)
+				ret = key_compare(x->package, y->package);
+			if (ret == 0)
+				ret = key_compare(x->core, y->core);
+			break;
+		case affinity_scatter:
+			if ((ret = key_compare(x->smt, y->smt)) == 0)
+				ret = key_compare(x->core_rank, y->core_rank);
+			if (ret == 0)
+				ret = key_compare(x->package, y->package);
+			break;
+		default:
+			break;
+	}
+	if (ret == 0)
+		ret = key_compare(x->id, y->id);
+	return ret;
+}
+
+/*
+ * affinity_map:
+ *
+ * 	Picks a cpu for every thread, or -1 if it shouldn't be pinned. The
+ * ranks are worked out by comparing every cpu with the ones before it,
+ * which is quadratic but only runs once.
+ */
+
+void affinity_map(enum affinity policy, thread_t threads, int *cpus)
+{
+	for (thread_t thread = 0; thread < threads; thread++)
+		cpus[thread] = -1;
+	if (policy == affinity_none)
+		return;
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		fprintf(stderr, "Can't read the cpu affinity, threads won't be pinned\n");
+		return;
+	}
+
+	size_t count = CPU_COUNT(&allowed);
+	struct cpu *cpu = malloc(sizeof(struct cpu) * count);
+	if (cpu == NULL)
+		abort();
+
+	size_t n = 0;
+	for (int id = 0; id < CPU_SETSIZE && n < count; id++) {
+		if (!CPU_ISSET(id, &allowed))
+			continue;
+		cpu[n].id = id;
+		cpu[n].package = topology_read(id, "physical_package_id");
+		cpu[n].core = topology_read(id, "core_id");
+		if (cpu[n].core < 0)
+			cpu[n].core = id; // No topology, treat every cpu as a core.
+		n++;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		cpu[i].smt = 0;
+		for (size_t j = 0; j < i; j++)
+			if (cpu[j].package == cpu[i].package && cpu[j].core == cpu[i].core)
+				cpu[i].smt++;
+	}
+	for (size_t i = 0; i < n; i++) {
+		cpu[i].core_rank = 0;
+		for (size_t j = 0; j < n; j++) {
+			if (cpu[j].package == cpu[i].package && cpu[j].core < cpu[i].core && cpu[j].smt == 0)
+				cpu[i].core_rank++;
+		}
+	}
+
+	sort_policy = policy;
+	qsort(cpu, n, sizeof(struct cpu), cpu_compare);
+
+	for (thread_t thread = 0; thread < threads && n > 0; thread++)
+		cpus[thread] = cpu[thread % n].id;
+	free(cpu);
+}
+
+void affinity_apply(int cpu)
+{
+	if (cpu < 0)
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		fprintf(stderr, "Can't pin a thread to cpu %d\n", cpu);
+}
+
+/*
+ * Control groups:
+ *
+ * 	A container may be given only a few cpus worth of time, even if it can
+ * see all of them. The quota is in cpu.max with cgroup v2, and in
+ * cpu.cfs_quota_us / cpu.cfs_period_us with v1. Every group above ours can
+ * have its own quota, so we walk up to the mount point and keep the lowest.
+ *
+ * 	The paths in /proc/self/cgroup are relative to the root of the
+ * hierarchy, which may be mounted somewhere below it in a container; see
+ * the root field of /proc/self/mountinfo.
+ */
+
+static bool has_token(const char *list, const char *token)
+{
+	size_t len = strlen(token);
+	for (const char *i = list; i != NULL; i = strchr(i, ',')) {
+		if (*i == ',')
+			i++;
+		if (strncmp(i, token, len) == 0 && (i[len] == ',' || i[len] == '\0'))
+			return true;
+	}
+	return false;
+}
+
+static double quota_read(const char *dir, bool v2)
+{
+	char path[PATH_MAX + PATH_MAX + 32];
+	double quota = -1.0;
+	double period = -1.0;
+
+	if (v2) {
+		snprintf(path, sizeof(path), "%s/cpu.max", dir);
+		FILE *fp = fopen(path, "r");
+		if (fp == NULL)
+			return 0.0;
+		if (fscanf(fp, "%lf %lf", &quota, &period) != 2)
+			quota = -1.0; // "max"
+		fclose(fp);
+	} else {
+		snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+		FILE *fp = fopen(path, "r");
+		if (fp == NULL)
+			return 0.0;
+		if (fscanf(fp, "%lf", &quota) != 1)
+			quota = -1.0;
+		fclose(fp);
+
+		snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+		fp = fopen(path, "r");
+		if (fp == NULL)
+			return 0.0;
+		if (fscanf(fp, "%lf", &period) != 1)
+			period = -1.0;
+		fclose(fp);
+	}
+	if (quota <= 0.0 || period <= 0.0)
+		return 0.0;
+	return (quota / period);
+}
+
+// The lowest quota from dir up to the mount point, or 0 for none.
+static double quota_walk(char *dir, size_t mount_len, bool v2)
+{
+	double ret = 0.0;
+	while (true) {
+		double quota = quota_read(dir, v2);
+		if (quota > 0.0 && (ret == 0.0 || quota < ret))
+			ret = quota;
+
+		char *slash = strrchr(dir, '/');
+		if (strlen(dir) <= mount_len || slash == NULL || (size_t)(slash - dir) < mount_len)
+			break;
+		*slash = '\0';
+	}
+	return ret;
+}
+
+static double cgroup_quota()
+{
+	char v1_path[PATH_MAX] = "";
+	char v2_path[PATH_MAX] = "";
+	char line[PATH_MAX + 256];
+
+	FILE *fp = fopen("/proc/self/cgroup", "r");
+	if (fp == NULL)
+		return 0.0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+		char *controllers = strchr(line, ':');
+		if (controllers == NULL)
+			continue;
+		char *path = strchr(++controllers, ':');
+		if (path == NULL)
+			continue;
+		*(path++) = '\0';
+		if (strlen(path) >= PATH_MAX)
+			continue;
+		if (*controllers == '\0')
+			strcpy(v2_path, path);
+		else if (has_token(controllers, "cpu"))
+			strcpy(v1_path, path);
+	}
+	fclose(fp);
+
+	fp = fopen("/proc/self/mountinfo", "r");
+	if (fp == NULL)
+		return 0.0;
+
+	double ret = 0.0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char root[PATH_MAX];
+		char mount[PATH_MAX];
+		char type[32];
+		char options[256];
+		char *fields = strstr(line, " - ");
+		if (fields == NULL)
+			continue;
+		if (sscanf(line, "%*s %*s %*s %4095s %4095s", root, mount) != 2)
+			continue;
+		if (sscanf(fields, " - %31s %*s %255s", type, options) != 2)
+			continue;
+
+		bool v2 = (strcmp(type, "cgroup2") == 0);
+		const char *path = (v2 ? v2_path : v1_path);
+		if (*path == '\0')
+			continue;
+		if (!v2 && (strcmp(type, "cgroup") != 0 || !has_token(options, "cpu")))
+			continue;
+
+		// Strip the root of the mount from our path, if it's there.
+		size_t root_len = strlen(root);
+		if (strcmp(root, "/") == 0)
+			root_len = 0;
+		if (strncmp(path, root, root_len) == 0)
+			path += root_len;
+		else
+			path = "";
+
+		char dir[PATH_MAX + PATH_MAX];
+		snprintf(dir, sizeof(dir), "%s%s", mount, path);
+		double quota = quota_walk(dir, strlen(mount), v2);
+		if (quota > 0.0 && (ret == 0.0 || quota < ret))
+			ret = quota;
+	}
+	fclose(fp);
+	return ret;
+}
+
+/*
+ * affinity_threads:
+ *
+ * 	The number of threads to run by default: the cpus in our affinity mask,
+ * rounded up to the cgroup quota if that's lower. It's reported if it's
+ * less than the cpus online.
+ */
+
+thread_t affinity_threads(long online)
+{
+	long ret = online;
+	long allowed = 0;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		allowed = CPU_COUNT(&set);
+		if (allowed > 0 && allowed < ret)
+			ret = allowed;
+	}
+
+	double quota = cgroup_quota();
+	if (quota > 0.0 && ceil(quota) < ret)
+		ret = ceil(quota);
+
+	if (ret < 1)
+		ret = 1;
+	if (ret > THREAD_T_MAX)
+		ret = THREAD_T_MAX;
+
+	if (ret < online) {
+		fprintf(stderr, "Using %ld thread(s): %ld cpu(s) online", ret, online);
+		if (allowed > 0)
+			fprintf(stderr, ", %ld in the affinity mask", allowed);
+		if (quota > 0.0)
+			fprintf(stderr, ", a cgroup quota of %.2f cpu(s)", quota);
+		fprintf(stderr, "\n");
+	}
+	return ret;
+}
+
+#else /* defined(__linux__) */
+
+thread_t affinity_threads(long online)
+{
+	if (online < 1)
+		return 1;
+	if (online > THREAD_T_MAX)
+		return THREAD_T_MAX;
+	return online;
+}
+
+void affinity_map(enum affinity policy, thread_t threads, int *cpus)
+{
+	for (thread_t thread = 0; thread < threads; thread++)
+		cpus[thread] = -1;
+	if (policy != affinity_none)
+		fprintf(stderr, "Thread affinity is only supported on Linux, threads won't be pinned\n");
+}
+
+void affinity_apply(ATTR_UNUSED int cpu)
+{
+}
+
+#endif /* defined(__linux__) */
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#ifndef HELSING_AFFINITY_H
+#define HELSING_AFFINITY_H
+
+#include "configuration.h"
+#include "configuration_adv.h"
+
+/*
+ * affinity:
+ *
+ * 	How worker threads are pinned to CPUs, based on the CPU topology that
+ * Linux exposes in sysfs. Only the CPUs the process is allowed to run on
+ * are used, and threads wrap around if there are more of them than CPUs.
+ *
+ * compact:  fill a core's SMT siblings first, then the next core
+ * scatter:  spread over packages, then cores, and use SMT siblings last
+ * physical: one thread per physical core first, then the SMT siblings
+ */
+
+enum affinity
+{
+	affinity_none,
+	affinity_compact,
+	affinity_scatter,
+	affinity_physical
+};
+
+int affinity_set(enum affinity *ptr, const char *str);
+void affinity_map(enum affinity policy, thread_t threads, int *cpus);
+void affinity_apply(int cpu);
+thread_t affinity_threads(long online);
+
+#endif /* HELSING_AFFINITY_H */
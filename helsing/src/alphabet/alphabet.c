@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+#include "helper.h"
+#include "alphabet.h"
+
+static int digit_from_char(int ch)
+{
+	if (isdigit(ch))
+		return (ch - '0');
+	if (isalpha(ch))
+		return (tolower(ch) - 'a' + 10);
+	return -1;
+}
+
+static char digit_to_char(digit_t digit)
+{
+	if (digit < 10)
+		return ('0' + digit);
+	return ('a' + digit - 10);
+}
+
+void alphabet_init(struct alphabet *ptr)
+{
+	ptr->restricted = false;
+	ptr->size = BASE;
+	for (digit_t i = 0; i < BASE; i++) {
+		ptr->allowed[i] = true;
+		ptr->digits[i] = i;
+		ptr->count[i] = 0;
+	}
+	ptr->multiset = false;
+	ptr->length = 0;
+}
+
+int alphabet_set(struct alphabet *ptr, const char *str)
+{
+	if (BASE > ALPHABET_NAMES) {
+		fprintf(stderr, "Digit alphabets need BASE <= %d\n", ALPHABET_NAMES);
+		return 1;
+	}
+
+	bool multiset = (str[0] == ALPHABET_MULTISET);
+	if (multiset)
+		str++;
+
+	bool allowed[BASE] = {false};
+	length_t count[BASE] = {0};
+	size_t length = 0;
+	for (size_t i = 0; isgraph(str[i]); i++) {
+		int digit = digit_from_char(str[i]);
+		if (digit < 0 || digit >= BASE) {
+			fprintf(stderr, "Invalid digit for base %d: %c\n", BASE, str[i]);
+			return 1;
+		}
+		allowed[digit] = true;
+		if (multiset && ++length > ALPHABET_TEXT_LENGTH - 1) {
+			fprintf(stderr, "The digit multiset is too long\n");
+			return 1;
+		}
+		count[digit] += 1;
+	}
+
+	digit_t size = 0;
+	for (digit_t i = 0; i < BASE; i++)
+		if (allowed[i])
+			size++;
+
+	if (size == 0 || (size == 1 && allowed[0])) {
+		fprintf(stderr, "The digit alphabet needs at least one non-zero digit\n");
+		return 1;
+	}
+	if (multiset && length % 2 != 0) {
+		fprintf(stderr, "The digit multiset needs an even number of digits\n");
+		return 1;
+	}
+
+	ptr->restricted = (size < BASE || multiset);
+	ptr->multiset = multiset;
+	ptr->length = (multiset ? length : 0);
+	ptr->size = 0;
+	for (digit_t i = 0; i < BASE; i++) {
+		ptr->allowed[i] = allowed[i];
+		ptr->count[i] = (multiset ? count[i] : 0);
+		if (allowed[i])
+			ptr->digits[ptr->size++] = i;
+	}
+	return 0;
+}
+
+bool alphabet_equal(const struct alphabet *a, const struct alphabet *b)
+{
+	if (a->restricted != b->restricted || a->multiset != b->multiset)
+		return false;
+	for (digit_t i = 0; i < BASE; i++)
+		if (a->allowed[i] != b->allowed[i] || a->count[i] != b->count[i])
+			return false;
+	return true;
+}
+
+void alphabet_fprint(FILE *fp, const struct alphabet *ptr)
+{
+	if (ptr->multiset)
+		fputc(ALPHABET_MULTISET, fp);
+	for (digit_t i = 0; i < ptr->size; i++) {
+		length_t times = (ptr->multiset ? ptr->count[ptr->digits[i]] : 1);
+		for (length_t j = 0; j < times; j++)
+			fputc(digit_to_char(ptr->digits[i]), fp);
+	}
+}
+
+/*
+ * Numerals:
+ *
+ * 	We count in the alphabet the way an odometer counts in decimal. Each
+ * position holds an index into alphabet->digits, so stepping to the next
+ * numeral is a carry over the indexes, and the value is updated by the
+ * difference of the digits that changed.
+ *
+ * 	The most significant digit can't be 0, lead() accounts for that.
+ */
+
+static digit_t lead(struct alphabet_numeral *ptr, length_t position)
+{
+	if (position == 0 && ptr->alphabet->digits[0] == 0)
+		return 1;
+	return 0;
+}
+
+static void numeral_reset(struct alphabet_numeral *ptr, const struct alphabet *alphabet, length_t length)
+{
+	OPTIONAL_ASSERT(length > 0);
+	OPTIONAL_ASSERT(length <= ALPHABET_NUMERAL_LENGTH);
+
+	ptr->alphabet = alphabet;
+	ptr->length = length;
+	ptr->weight[length - 1] = 1;
+	for (length_t i = length - 1; i > 0; i--)
+		ptr->weight[i - 1] = ptr->weight[i] * BASE;
+}
+
+static void numeral_value(struct alphabet_numeral *ptr)
+{
+	ptr->value = 0;
+	for (length_t i = 0; i < ptr->length; i++)
+		ptr->value += ptr->alphabet->digits[ptr->index[i]] * ptr->weight[i];
+}
+
+static void numeral_fill(struct alphabet_numeral *ptr, length_t from, digit_t index)
+{
+	for (length_t i = from; i < ptr->length; i++)
+		ptr->index[i] = index;
+}
+
+// Smallest numeral >= x.
+bool alphabet_numeral_ceil(struct alphabet_numeral *ptr, const struct alphabet *alphabet, length_t length, fang_t x)
+{
+	numeral_reset(ptr, alphabet, length);
+	if (x / ptr->weight[0] >= BASE)
+		return false;
+
+	for (length_t i = 0; i < length; i++) {
+		digit_t x_digit = (x / ptr->weight[i]) % BASE;
+		digit_t k = lead(ptr, i);
+		while (k < alphabet->size && alphabet->digits[k] < x_digit)
+			k++;
+
+		if (k == alphabet->size) {
+			// Carry into the previous positions.
+			length_t j = i;
+			for (; j > 0 && ptr->index[j - 1] + 1 == alphabet->size; j--);
+			if (j == 0)
+				return false;
+			ptr->index[j - 1] += 1;
+			numeral_fill(ptr, j, 0);
+			break;
+		}
+		ptr->index[i] = k;
+		if (alphabet->digits[k] > x_digit) {
+			numeral_fill(ptr, i + 1, 0);
+			break;
+		}
+	}
+	numeral_value(ptr);
+	return true;
+}
+
+// Largest numeral <= x.
+bool alphabet_numeral_floor(struct alphabet_numeral *ptr, const struct alphabet *alphabet, length_t length, fang_t x)
+{
+	numeral_reset(ptr, alphabet, length);
+	if (x / ptr->weight[0] >= BASE) {
+		ptr->index[0] = alphabet->size - 1;
+		numeral_fill(ptr, 1, alphabet->size - 1);
+		numeral_value(ptr);
+		return true;
+	}
+
+	for (length_t i = 0; i < length; i++) {
+		digit_t x_digit = (x / ptr->weight[i]) % BASE;
+		digit_t k = alphabet->size;
+		while (k > lead(ptr, i) && alphabet->digits[k - 1] > x_digit)
+			k--;
+
+		if (k == lead(ptr, i)) {
+			// Borrow from the previous positions.
+			length_t j = i;
+			for (; j > 0 && ptr->index[j - 1] == lead(ptr, j - 1); j--);
+			if (j == 0)
+				return false;
+			ptr->index[j - 1] -= 1;
+			numeral_fill(ptr, j, alphabet->size - 1);
+			break;
+		}
+		ptr->index[i] = k - 1;
+		if (alphabet->digits[k - 1] < x_digit) {
+			numeral_fill(ptr, i + 1, alphabet->size - 1);
+			break;
+		}
+	}
+	numeral_value(ptr);
+	return true;
+}
+
+bool alphabet_numeral_next(struct alphabet_numeral *ptr)
+{
+	const struct alphabet *alphabet = ptr->alphabet;
+	const digit_t top = alphabet->size - 1;
+	const digit_t span = alphabet->digits[top] - alphabet->digits[0];
+
+	length_t i = ptr->length;
+	for (; i > 0 && ptr->index[i - 1] == top; i--);
+	if (i == 0)
+		return false;
+
+	for (length_t j = i; j < ptr->length; j++) {
+		ptr->index[j] = 0;
+		ptr->value -= span * ptr->weight[j];
+	}
+	digit_t old = alphabet->digits[ptr->index[i - 1]];
+	ptr->index[i - 1] += 1;
+	ptr->value += (alphabet->digits[ptr->index[i - 1]] - old) * ptr->weight[i - 1];
+	return true;
+}
+
+bool alphabet_numeral_prev(struct alphabet_numeral *ptr)
+{
+	const struct alphabet *alphabet = ptr->alphabet;
+	const digit_t top = alphabet->size - 1;
+	const digit_t span = alphabet->digits[top] - alphabet->digits[0];
+
+	length_t i = ptr->length;
+	for (; i > 0 && ptr->index[i - 1] == lead(ptr, i - 1); i--);
+	if (i == 0)
+		return false;
+
+	for (length_t j = i; j < ptr->length; j++) {
+		ptr->index[j] = top;
+		ptr->value += span * ptr->weight[j];
+	}
+	digit_t old = alphabet->digits[ptr->index[i - 1]];
+	ptr->index[i - 1] -= 1;
+	ptr->value -= (old - alphabet->digits[ptr->index[i - 1]]) * ptr->weight[i - 1];
+	return true;
+}
+
+/*
+ * Multisets:
+ *
+ * 	alphabet_numeral_fits tells whether a numeral uses no digit more often
+ * than count allows. alphabet_numeral_ceil_exact and alphabet_numeral_next_exact
+ * walk the numerals that use exactly the digits of count, in ascending order:
+ * these are the permutations of the digits, and the next one is the next
+ * permutation of the indexes.
+ */
+
+bool alphabet_numeral_fits(const struct alphabet_numeral *ptr, const length_t count[BASE])
+{
+	length_t used[BASE] = {0};
+	for (length_t i = 0; i < ptr->length; i++) {
+		digit_t digit = ptr->alphabet->digits[ptr->index[i]];
+		if (++used[digit] > count[digit])
+			return false;
+	}
+	return true;
+}
+
+// Smallest numeral >= x, made of exactly the digits of count.
+bool alphabet_numeral_ceil_exact(struct alphabet_numeral *ptr, const struct alphabet *alphabet, const length_t count[BASE], length_t length, fang_t x)
+{
+	numeral_reset(ptr, alphabet, length);
+	if (x / ptr->weight[0] >= BASE)
+		return false;
+
+	length_t left[BASE]; // Indexed like alphabet->digits
+	for (digit_t k = 0; k < alphabet->size; k++)
+		left[k] = count[alphabet->digits[k]];
+
+	/*
+	 * Follow the digits of x as long as we have them, and remember the last
+	 * position where a bigger digit was left.
+	 */
+	length_t bigger = length; // none
+	length_t i = 0;
+	for (; i < length; i++) {
+		digit_t x_digit = (x / ptr->weight[i]) % BASE;
+		digit_t k = 0;
+		while (k < alphabet->size && alphabet->digits[k] < x_digit)
+			k++;
+		for (digit_t b = k; b < alphabet->size; b++) {
+			if (left[b] > 0 && alphabet->digits[b] > x_digit) {
+				bigger = i;
+				break;
+			}
+		}
+		if (k == alphabet->size || alphabet->digits[k] != x_digit || left[k] == 0)
+			break;
+		ptr->index[i] = k;
+		left[k] -= 1;
+	}
+
+	if (i < length) {
+		if (bigger == length)
+			return false;
+		for (length_t j = bigger; j < i; j++)
+			left[ptr->index[j]] += 1;
+
+		digit_t x_digit = (x / ptr->weight[bigger]) % BASE;
+		digit_t k = 0;
+		while (left[k] == 0 || alphabet->digits[k] <= x_digit)
+			k++;
+		ptr->index[bigger] = k;
+		left[k] -= 1;
+
+		// The rest in ascending order.
+		k = 0;
+		for (length_t j = bigger + 1; j < length; j++) {
+			while (left[k] == 0)
+				k++;
+			ptr->index[j] = k;
+			left[k] -= 1;
+		}
+	}
+	numeral_value(ptr);
+	return true;
+}
+
+bool alphabet_numeral_next_exact(struct alphabet_numeral *ptr)
+{
+	length_t i = ptr->length - 1;
+	while (i > 0 && ptr->index[i - 1] >= ptr->index[i])
+		i--;
+	if (i == 0)
+		return false;
+
+	length_t j = ptr->length - 1;
+	while (ptr->index[j] <= ptr->index[i - 1])
+		j--;
+
+	digit_t tmp = ptr->index[i - 1];
+	ptr->index[i - 1] = ptr->index[j];
+	ptr->index[j] = tmp;
+	for (length_t a = i, b = ptr->length - 1; a < b; a++, b--) {
+		tmp = ptr->index[a];
+		ptr->index[a] = ptr->index[b];
+		ptr->index[b] = tmp;
+	}
+	numeral_value(ptr);
+	return true;
+}
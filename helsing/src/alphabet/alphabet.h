@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#ifndef HELSING_ALPHABET_H
+#define HELSING_ALPHABET_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <limits.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+
+/*
+ * alphabet:
+ *
+ * The set of digits a fang is allowed to have. Digits are named 0-9, then
+ * a-z, so an alphabet can only be given for BASE <= 36.
+ *
+ * A multiset, written with a leading '=', also fixes how many times each
+ * digit appears: only the numbers made of exactly these digits are searched.
+ */
+
+#define ALPHABET_NAMES 36
+#define ALPHABET_MULTISET '='
+#define ALPHABET_TEXT_LENGTH (1 + sizeof(vamp_t) * CHAR_BIT) // Longest text of alphabet_fprint
+
+struct alphabet
+{
+	bool restricted; // false if every digit is allowed
+	bool allowed[BASE];
+	digit_t size;
+	digit_t digits[BASE]; // allowed digits, in ascending order
+	bool multiset;
+	length_t count[BASE]; // Times each digit appears, if multiset
+	length_t length; // Digits of the multiset, 0 unless multiset
+};
+
+void alphabet_init(struct alphabet *ptr);
+int alphabet_set(struct alphabet *ptr, const char *str);
+bool alphabet_equal(const struct alphabet *a, const struct alphabet *b);
+void alphabet_fprint(FILE *fp, const struct alphabet *ptr);
+
+/*
+ * alphabet_numeral:
+ *
+ * A numeral of fixed length, whose digits all belong to an alphabet.
+ * index[0] is the most significant digit.
+ */
+
+#define ALPHABET_NUMERAL_LENGTH (sizeof(fang_t) * CHAR_BIT)
+
+struct alphabet_numeral
+{
+	const struct alphabet *alphabet;
+	length_t length;
+	fang_t value;
+	digit_t index[ALPHABET_NUMERAL_LENGTH];
+	fang_t weight[ALPHABET_NUMERAL_LENGTH];
+};
+
+bool alphabet_numeral_ceil(struct alphabet_numeral *ptr, const struct alphabet *alphabet, length_t length, fang_t x);
+bool alphabet_numeral_floor(struct alphabet_numeral *ptr, const struct alphabet *alphabet, length_t length, fang_t x);
+bool alphabet_numeral_next(struct alphabet_numeral *ptr);
+bool alphabet_numeral_prev(struct alphabet_numeral *ptr);
+bool alphabet_numeral_fits(const struct alphabet_numeral *ptr, const length_t count[BASE]);
+bool alphabet_numeral_ceil_exact(struct alphabet_numeral *ptr, const struct alphabet *alphabet, const length_t count[BASE], length_t length, fang_t x);
+bool alphabet_numeral_next_exact(struct alphabet_numeral *ptr);
+
+#endif /* HELSING_ALPHABET_H */
@@ -11,6 +11,8 @@
 #if (VAMPIRE_NUMBER_OUTPUTS) // applies to entire file
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include "array.h"
 #include "llnode.h"
@@ -26,7 +28,6 @@
 #include <threads.h>
 #endif
 
-#ifdef STORE_RESULTS
 void array_free(struct array *ptr)
 {
 	if (ptr == NULL)
@@ -36,7 +37,127 @@ void array_free(struct array *ptr)
 	free(ptr->fangs);
 	free(ptr);
 }
-#endif
+
+size_t array_size(struct array *ptr)
+{
+	if (ptr == NULL)
+		return 0;
+	return ptr->size;
+}
+
+size_t array_bytes(struct array *ptr)
+{
+	if (ptr == NULL)
+		return 0;
+	return (sizeof(struct array) + ptr->size * 2 * sizeof(vamp_t));
+}
+
+/*
+ * array_save, array_load:
+ *
+ * Moves an array to the current position of a file and back, for the
+ * spill file of the taskboard and the task checkpoint. Both return 1 on an
+ * I/O error; array_load also when the file is short, and leaves *ptr NULL.
+ */
+
+int array_save(struct array *ptr, FILE *fp)
+{
+	OPTIONAL_ASSERT(ptr != NULL);
+
+	if (fwrite(&(ptr->size), sizeof(ptr->size), 1, fp) != 1)
+		return 1;
+	if (fwrite(ptr->number, sizeof(vamp_t), ptr->size, fp) != ptr->size)
+		return 1;
+	if (fwrite(ptr->fangs, sizeof(vamp_t), ptr->size, fp) != ptr->size)
+		return 1;
+	return 0;
+}
+
+int array_load(struct array **ptr, FILE *fp)
+{
+	OPTIONAL_ASSERT(ptr != NULL);
+	OPTIONAL_ASSERT(*ptr == NULL);
+
+	struct array *new = malloc(sizeof(struct array));
+	if (new == NULL)
+		abort();
+
+	new->number = NULL;
+	new->fangs = NULL;
+	if (fread(&(new->size), sizeof(new->size), 1, fp) != 1)
+		goto err;
+	if (new->size > SIZE_MAX / sizeof(vamp_t))
+		goto err;
+
+	new->number = malloc(sizeof(vamp_t) * new->size);
+	new->fangs = malloc(sizeof(vamp_t) * new->size);
+	if (new->size > 0 && (new->number == NULL || new->fangs == NULL))
+		goto err;
+
+	if (fread(new->number, sizeof(vamp_t), new->size, fp) != new->size)
+		goto err;
+	if (fread(new->fangs, sizeof(vamp_t), new->size, fp) != new->size)
+		goto err;
+
+	*ptr = new;
+	return 0;
+err:
+	free(new->number);
+	free(new->fangs);
+	free(new);
+	return 1;
+}
+
+/*
+ * array_merge:
+ *
+ * Merges two arrays of results into *ptr and frees other. A number that's
+ * in both arrays gets the sum of their fang pairs.
+ */
+
+void array_merge(struct array **ptr, struct array *other)
+{
+	OPTIONAL_ASSERT(ptr != NULL);
+
+	if (other == NULL)
+		return;
+	if (*ptr == NULL) {
+		*ptr = other;
+		return;
+	}
+
+	struct array *a = *ptr;
+	size_t size = a->size + other->size;
+
+	vamp_t *number = malloc(sizeof(vamp_t) * size);
+	if (number == NULL)
+		abort();
+
+	vamp_t *fangs = malloc(sizeof(vamp_t) * size);
+	if (fangs == NULL)
+		abort();
+
+	size_t i = 0, j = 0, k = 0;
+	while (i < a->size || j < other->size) {
+		if (j == other->size || (i < a->size && a->number[i] < other->number[j])) {
+			number[k] = a->number[i];
+			fangs[k++] = a->fangs[i++];
+		} else if (i == a->size || other->number[j] < a->number[i]) {
+			number[k] = other->number[j];
+			fangs[k++] = other->fangs[j++];
+		} else {
+			number[k] = a->number[i];
+			fangs[k++] = a->fangs[i++] + other->fangs[j++];
+		}
+	}
+
+	free(a->number);
+	free(a->fangs);
+	a->number = number;
+	a->fangs = fangs;
+	a->size = k;
+	array_free(other);
+}
 
 int cmpvampt(const void *a, const void *b)
 {
@@ -51,14 +172,10 @@ int cmpvampt(const void *a, const void *b)
 		return 0;
 }
 
-void array_new(
-	struct array **ptr,
-	struct llvamp_t **ll,
-	vamp_t (*count_ptr)[COUNT_ARRAY_SIZE])
+void array_new(struct array **ptr, struct llvamp_t **ll)
 {
 	OPTIONAL_ASSERT(ptr != NULL);
 	OPTIONAL_ASSERT(*ptr == NULL);
-	OPTIONAL_ASSERT(count_ptr != NULL);
 
 	if (ll == NULL)
 		return;
@@ -90,55 +207,63 @@ void array_new(
 	// sort
 	qsort(number, size, sizeof(vamp_t), cmpvampt);
 
-	// filter fangs & resize
-	vamp_t count[COUNT_ARRAY_SIZE];
-	memset(count, 0, sizeof(count));
-
-	if (size > 0)
-		fangs[0] = 1;
 	// Combine duplicate entries
-	for (size_t i = 1; i < size; i++) {
-		fangs[i] = 1;
-		if (number[i - 1] != number[i])
-			continue;
-
-		fangs[i] += fangs[i - 1];
-		fangs[i - 1] = 0;
-		number[i - 1] = 0;
-
-		if (fangs[i] > MAX_FANG_PAIRS) {
-			fangs[i] = MAX_FANG_PAIRS;
-			count[COUNT_ARRAY_REMAINDER]++;
-		}
-	}
-
-	// Filter out with MIN_FANG_PAIRS & count the results
+	size_t k = 0;
 	for (size_t i = 0; i < size; i++) {
-		if (fangs[i] < MIN_FANG_PAIRS) {
-			number[i] = 0;
-			fangs[i] = 0;
+		if (k > 0 && number[k - 1] == number[i]) {
+			fangs[k - 1] += 1;
 			continue;
 		}
-		for (vamp_t j = MIN_FANG_PAIRS - 1; j < fangs[i]; j++)
-			count[j]++;
+		number[k] = number[i];
+		fangs[k++] = 1;
 	}
 
-#ifdef STORE_RESULTS
 	struct array *new = malloc(sizeof(struct array));
 	if (new == NULL)
 		abort();
 
 	new->number = number;
 	new->fangs = fangs;
-	new->size = size;
+	new->size = k;
 	*ptr = new;
-#else /* STORE_RESULTS */
-	free(number);
-	free(fangs);
+	return;
+}
+
+/*
+ * array_finish:
+ *
+ * 	Filters out the numbers with fewer than MIN_FANG_PAIRS, caps the rest at
+ * MAX_FANG_PAIRS and adds them to the count. The array is only kept if the
+ * results are going to be printed or hashed.
+ */
+
+void array_finish(struct array **ptr, vamp_t (*count_ptr)[COUNT_ARRAY_SIZE])
+{
+	OPTIONAL_ASSERT(ptr != NULL);
+	OPTIONAL_ASSERT(count_ptr != NULL);
+
+	struct array *array = *ptr;
+	if (array == NULL)
+		return;
+
+	for (size_t i = 0; i < array->size; i++) {
+		if (array->fangs[i] > MAX_FANG_PAIRS) {
+			(*count_ptr)[COUNT_ARRAY_REMAINDER] += array->fangs[i] - MAX_FANG_PAIRS;
+			array->fangs[i] = MAX_FANG_PAIRS;
+		}
+		if (array->fangs[i] < MIN_FANG_PAIRS) {
+			array->number[i] = 0;
+			array->fangs[i] = 0;
+			continue;
+		}
+		for (vamp_t j = MIN_FANG_PAIRS - 1; j < array->fangs[i]; j++)
+			(*count_ptr)[j]++;
+	}
+
+#ifndef STORE_RESULTS
+	array_free(array);
 	*ptr = NULL;
 #endif /* STORE_RESULTS */
-	memcpy(count_ptr, count, sizeof(*count_ptr));
-	return;
 }
 
 #if VAMPIRE_HASH
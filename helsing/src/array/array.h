@@ -7,38 +7,80 @@
 #define HELSING_ARRAY_H
 
 #include <threads.h>
+#include <stdio.h>
 
 #include "configuration_adv.h"
 #include "llnode.h"
 #include "hash.h"
 
-#if (VAMPIRE_NUMBER_OUTPUTS) && (defined STORE_RESULTS)
+/*
+ * array:
+ *
+ * 	The vampire numbers of a piece, sorted, with their fang pair counts.
+ * Pieces that split the multipliers of an interval can find fang pairs of
+ * the same number, so the counts are only final once every piece of the
+ * task has been merged in. array_finish then applies MIN_FANG_PAIRS and
+ * MAX_FANG_PAIRS, and counts the results.
+ */
+
+#if VAMPIRE_NUMBER_OUTPUTS
 struct array
 {
 	vamp_t *number;
 	vamp_t *fangs;
 	size_t size;
 };
+void array_new(struct array **ptr, struct llvamp_t **ll);
 void array_free(struct array *ptr);
+void array_merge(struct array **ptr, struct array *other);
+void array_finish(struct array **ptr, vamp_t (*count_ptr)[COUNT_ARRAY_SIZE]);
+size_t array_size(struct array *ptr);
+size_t array_bytes(struct array *ptr);
+int array_save(struct array *ptr, FILE *fp);
+int array_load(struct array **ptr, FILE *fp);
 #else
 struct array
 {
 	int unused;
 };
+static inline void array_new(
+	ATTR_UNUSED struct array **ptr,
+	ATTR_UNUSED struct llvamp_t **ll)
+{
+}
 static inline void array_free(ATTR_UNUSED struct array *ptr)
 {
 }
-#endif /* (VAMPIRE_NUMBER_OUTPUTS) && (defined STORE_RESULTS) */
-
-#if VAMPIRE_NUMBER_OUTPUTS
-void array_new(struct array **ptr, struct llvamp_t **ll, vamp_t (*count_ptr)[COUNT_ARRAY_SIZE]);
-#else
-static inline void array_new(
+static inline void array_merge(
+	ATTR_UNUSED struct array **ptr,
+	ATTR_UNUSED struct array *other)
+{
+}
+static inline void array_finish(
 	ATTR_UNUSED struct array **ptr,
-	ATTR_UNUSED struct llvamp_t **ll,
 	ATTR_UNUSED vamp_t (*count_ptr)[COUNT_ARRAY_SIZE])
 {
 }
+static inline size_t array_size(ATTR_UNUSED struct array *ptr)
+{
+	return 0;
+}
+static inline size_t array_bytes(ATTR_UNUSED struct array *ptr)
+{
+	return 0;
+}
+static inline int array_save(
+	ATTR_UNUSED struct array *ptr,
+	ATTR_UNUSED FILE *fp)
+{
+	return 1;
+}
+static inline int array_load(
+	ATTR_UNUSED struct array **ptr,
+	ATTR_UNUSED FILE *fp)
+{
+	return 1;
+}
 #endif /* VAMPIRE_NUMBER_OUTPUTS */
 
 #if (VAMPIRE_NUMBER_OUTPUTS) && (VAMPIRE_HASH)
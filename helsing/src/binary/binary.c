@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+#include "helper.h"
+#include "array.h"
+#include "binary.h"
+
+int format_set(enum output_format *ptr, const char *str)
+{
+	if (strcmp(str, "text") == 0) {
+		*ptr = format_text;
+		return 0;
+	}
+	if (strcmp(str, "binary") == 0) {
+#if (VAMPIRE_NUMBER_OUTPUTS) && (defined PRINT_RESULTS)
+		*ptr = format_binary;
+		return 0;
+#else
+		fprintf(stderr, "--format binary requires VAMPIRE_INDEX, VAMPIRE_PRINT or VAMPIRE_INTEGRAL\n");
+		return 1;
+#endif
+	}
+	fprintf(stderr, "Unknown output format: %s, expected text or binary\n", str);
+	return 1;
+}
+
+#if (VAMPIRE_NUMBER_OUTPUTS) && (defined PRINT_RESULTS)
+
+#define BINARY_MAGIC "helsing results"
+#define BINARY_FANGS (MAX_FANG_PAIRS > MIN_FANG_PAIRS)
+
+// A growing buffer for the payload of a frame.
+struct frame
+{
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+};
+
+static void frame_put(struct frame *ptr, unsigned char byte)
+{
+	if (ptr->size == ptr->capacity) {
+		ptr->capacity = (ptr->capacity == 0 ? BUFSIZ : ptr->capacity * 2);
+		ptr->data = realloc(ptr->data, ptr->capacity);
+		if (ptr->data == NULL)
+			abort();
+	}
+	ptr->data[ptr->size++] = byte;
+}
+
+static void frame_varint(struct frame *ptr, vamp_t x)
+{
+	for (; x >= 0x80; x >>= 7)
+		frame_put(ptr, (x & 0x7f) | 0x80);
+	frame_put(ptr, x);
+}
+
+static void frame_write(struct frame *ptr, FILE *fp, char tag)
+{
+	struct frame length = {NULL, 0, 0};
+	frame_varint(&length, ptr->size);
+	fputc(tag, fp);
+	fwrite(length.data, 1, length.size, fp);
+	fwrite(ptr->data, 1, ptr->size, fp);
+	free(length.data);
+}
+
+void binary_header(FILE *fp)
+{
+	struct frame frame = {NULL, 0, 0};
+	for (const char *i = BINARY_MAGIC; *i != '\0'; i++)
+		frame_put(&frame, *i);
+	frame_varint(&frame, BASE);
+	frame_varint(&frame, MIN_FANG_PAIRS);
+	frame_varint(&frame, MAX_FANG_PAIRS);
+	frame_varint(&frame, BINARY_FANGS);
+	frame_write(&frame, fp, 'H');
+	free(frame.data);
+	fflush(fp);
+}
+
+/*
+ * binary_block:
+ *
+ * 	Writes the results of a task, which may be NULL if there are none, and
+ * updates prev the way array_print does.
+ */
+
+void binary_block(
+	FILE *fp,
+	struct array *ptr,
+	vamp_t lmin,
+	vamp_t lmax,
+	mtx_t *stdout_mtx,
+	vamp_t count[COUNT_ARRAY_SIZE],
+	vamp_t (*prev)[COUNT_ARRAY_SIZE])
+{
+	size_t size = 0;
+	for (size_t i = 0; ptr != NULL && i < ptr->size; i++)
+		size += (ptr->number[i] != 0);
+
+	struct frame frame = {NULL, 0, 0};
+	frame_varint(&frame, lmin);
+	frame_varint(&frame, lmax);
+	frame_varint(&frame, size);
+	for (size_t j = 0; j < COUNT_ARRAY_SIZE; j++)
+		frame_varint(&frame, count[j]);
+	for (size_t j = 0; j < COUNT_ARRAY_SIZE; j++)
+		frame_varint(&frame, (*prev)[j]);
+
+	vamp_t last = lmin;
+	for (size_t i = 0; ptr != NULL && i < ptr->size; i++) {
+		if (ptr->number[i] == 0)
+			continue;
+
+		frame_varint(&frame, ptr->number[i] - last);
+		last = ptr->number[i];
+		if (BINARY_FANGS)
+			frame_varint(&frame, ptr->fangs[i]);
+		for (size_t j = MIN_FANG_PAIRS - 1; j < MAX_FANG_PAIRS && j < ptr->fangs[i]; j++)
+			(*prev)[j] = ptr->number[i];
+	}
+
+	mtx_lock(stdout_mtx);
+	frame_write(&frame, fp, 'B');
+	fflush(fp);
+	mtx_unlock(stdout_mtx);
+	free(frame.data);
+}
+
+static bool read_varint(const unsigned char *data, size_t size, size_t *pos, vamp_t *x)
+{
+	*x = 0;
+	for (size_t shift = 0; *pos < size && shift < sizeof(vamp_t) * 8; shift += 7) {
+		unsigned char byte = data[(*pos)++];
+		*x |= (vamp_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// Reads a varint straight from the stream, for the frame length.
+static int fread_varint(FILE *fp, size_t *x)
+{
+	*x = 0;
+	for (size_t shift = 0; shift < sizeof(size_t) * 8; shift += 7) {
+		int byte = fgetc(fp);
+		if (byte == EOF)
+			return 1;
+		*x |= (size_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return 0;
+	}
+	return 1;
+}
+
+static int decode_header(const unsigned char *data, size_t size)
+{
+	size_t pos = strlen(BINARY_MAGIC);
+	if (size < pos || memcmp(data, BINARY_MAGIC, pos) != 0) {
+		fprintf(stderr, "Not a stream of results\n");
+		return 1;
+	}
+
+	vamp_t base = 0, min = 0, max = 0, fangs = 0;
+	bool ok = read_varint(data, size, &pos, &base);
+	ok = ok && read_varint(data, size, &pos, &min);
+	ok = ok && read_varint(data, size, &pos, &max);
+	ok = ok && read_varint(data, size, &pos, &fangs);
+	if (!ok || base != BASE || min != MIN_FANG_PAIRS || max != MAX_FANG_PAIRS || fangs != BINARY_FANGS) {
+		fprintf(stderr, "The stream was written by a build with a different BASE, MIN_FANG_PAIRS or MAX_FANG_PAIRS\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int decode_block(const unsigned char *data, size_t size, mtx_t *stdout_mtx)
+{
+	vamp_t lmin = 0, lmax = 0, results = 0;
+	vamp_t count[COUNT_ARRAY_SIZE];
+	vamp_t prev[COUNT_ARRAY_SIZE];
+	size_t pos = 0;
+
+	bool ok = read_varint(data, size, &pos, &lmin);
+	ok = ok && read_varint(data, size, &pos, &lmax);
+	ok = ok && read_varint(data, size, &pos, &results);
+	for (size_t j = 0; j < COUNT_ARRAY_SIZE; j++)
+		ok = ok && read_varint(data, size, &pos, &(count[j]));
+	for (size_t j = 0; j < COUNT_ARRAY_SIZE; j++)
+		ok = ok && read_varint(data, size, &pos, &(prev[j]));
+	if (!ok || results > size) // Every result takes a byte at least
+		return 1;
+
+	struct array *array = malloc(sizeof(struct array));
+	if (array == NULL)
+		abort();
+	array->size = results;
+	array->number = malloc(sizeof(vamp_t) * results);
+	array->fangs = malloc(sizeof(vamp_t) * results);
+	if (results > 0 && (array->number == NULL || array->fangs == NULL))
+		abort();
+
+	vamp_t last = lmin;
+	for (size_t i = 0; ok && i < array->size; i++) {
+		vamp_t delta;
+		ok = read_varint(data, size, &pos, &delta);
+		array->number[i] = last + delta;
+		last = array->number[i];
+		array->fangs[i] = MIN_FANG_PAIRS;
+		if (BINARY_FANGS)
+			ok = ok && read_varint(data, size, &pos, &(array->fangs[i]));
+	}
+	ok = ok && (pos == size) && (last <= lmax);
+	if (ok && array->size > 0)
+		array_print(array, stdout_mtx, count, &prev);
+	array_free(array);
+	return !ok;
+}
+
+/*
+ * binary_decode:
+ *
+ * 	Prints a stream of results as text, from a file or from stdin if path
+ * is "-".
+ */
+
+int binary_decode(const char *path)
+{
+	FILE *fp = stdin;
+	if (strcmp(path, "-") != 0)
+		fp = fopen(path, "rb");
+	if (fp == NULL) {
+		fprintf(stderr, "%s doesn't exist\n", path);
+		return 1;
+	}
+
+	mtx_t stdout_mtx;
+	mtx_init(&stdout_mtx, mtx_plain);
+	unsigned char *data = NULL;
+	bool has_header = false;
+	int rc = 0;
+	int tag;
+	while (!rc && (tag = fgetc(fp)) != EOF) {
+		size_t size;
+		rc = fread_varint(fp, &size);
+		if (!rc) {
+			data = realloc(data, size + 1);
+			if (data == NULL)
+				abort();
+			rc = (fread(data, 1, size, fp) != size);
+		}
+		if (rc)
+			break;
+
+		if (tag == 'H') {
+			rc = decode_header(data, size);
+			has_header = true;
+		} else if (tag == 'B' && has_header) {
+			rc = decode_block(data, size, &stdout_mtx);
+		} else {
+			rc = 1;
+		}
+	}
+	if (rc)
+		fprintf(stderr, "%s has bad data\n", path);
+	free(data);
+	mtx_destroy(&stdout_mtx);
+	if (fp != stdin)
+		fclose(fp);
+	return rc;
+}
+
+#endif /* (VAMPIRE_NUMBER_OUTPUTS) && (defined PRINT_RESULTS) */
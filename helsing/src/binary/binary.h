@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#ifndef HELSING_BINARY_H
+#define HELSING_BINARY_H
+
+#include <stdio.h>
+#include <threads.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+#include "array.h"
+
+/*
+ * binary:
+ *
+ * 	With --format binary the results are written to stdout as a stream of
+ * frames, instead of text. Every frame is a tag byte, the length of its
+ * payload and the payload:
+ *
+ * 'H': the stream header: "helsing results", BASE, MIN_FANG_PAIRS,
+ *      MAX_FANG_PAIRS and whether the blocks have fang pair counts.
+ * 'B': the results of a task: lmin, lmax, the number of results, then count
+ *      and prev before the task (see array_print), and every result as the
+ *      difference from the one before it, or from lmin for the first. The
+ *      fang pairs follow every result, unless MIN_FANG_PAIRS is
+ *      MAX_FANG_PAIRS.
+ *
+ * 	The numbers are varints: 7 bits at a time, lowest first, with the top
+ * bit set on every byte but the last. Every run starts with a header, so the
+ * output of a resumed run can be appended to the same file. --decode turns
+ * a stream back into the text that the build would have printed.
+ */
+
+enum output_format
+{
+	format_text,
+	format_binary
+};
+
+int format_set(enum output_format *ptr, const char *str);
+
+#if (VAMPIRE_NUMBER_OUTPUTS) && (defined PRINT_RESULTS)
+void binary_header(FILE *fp);
+void binary_block(
+	FILE *fp,
+	struct array *ptr,
+	vamp_t lmin,
+	vamp_t lmax,
+	mtx_t *stdout_mtx,
+	vamp_t count[COUNT_ARRAY_SIZE],
+	vamp_t (*prev)[COUNT_ARRAY_SIZE]);
+int binary_decode(const char *path);
+#else
+static inline void binary_header(ATTR_UNUSED FILE *fp)
+{
+}
+static inline void binary_block(
+	ATTR_UNUSED FILE *fp,
+	ATTR_UNUSED struct array *ptr,
+	ATTR_UNUSED vamp_t lmin,
+	ATTR_UNUSED vamp_t lmax,
+	ATTR_UNUSED mtx_t *stdout_mtx,
+	ATTR_UNUSED vamp_t count[COUNT_ARRAY_SIZE],
+	ATTR_UNUSED vamp_t (*prev)[COUNT_ARRAY_SIZE])
+{
+}
+static inline int binary_decode(ATTR_UNUSED const char *path)
+{
+	fprintf(stderr, "--decode requires VAMPIRE_INDEX, VAMPIRE_PRINT or VAMPIRE_INTEGRAL\n");
+	return 1;
+}
+#endif /* (VAMPIRE_NUMBER_OUTPUTS) && (defined PRINT_RESULTS) */
+#endif /* HELSING_BINARY_H */
@@ -3,6 +3,10 @@
  * Copyright (c) 2021-2025 Pierro Zachareas
  */
 
+#if (__has_include("unistd.h"))
+#define _POSIX_C_SOURCE 200809L // fileno, fsync
+#endif
+
 #include "configuration.h"
 #include "configuration_adv.h"
 
@@ -11,12 +15,22 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <assert.h>
 #include <ctype.h>	// isdigit
+#include <threads.h>
+#include <stdatomic.h>
+#if (__has_include("unistd.h"))
+	#include <unistd.h> // fsync
+	#include <fcntl.h>
+#endif
 #include "helper.h"
+#include "task.h"
+#include "array.h"
 #include "taskboard.h"
 #include "options.h"
 #include "interval.h"
+#include "alphabet.h"
 
 int touch_checkpoint(struct options_t options, struct interval_t interval)
 {
@@ -31,7 +45,12 @@ int touch_checkpoint(struct options_t options, struct interval_t interval)
 		return 1;
 	}
 	fp = fopen(options.checkpoint, "w+");
-	helsing_fprint(fp, "vsvs", interval.min, " ", interval.max, "\n");
+	helsing_fprint(fp, "vsv", interval.min, " ", interval.max);
+	if (options.digits.restricted) {
+		fprintf(fp, " ");
+		alphabet_fprint(fp, &(options.digits));
+	}
+	fprintf(fp, "\n");
 	fclose(fp);
 	return 0;
 }
@@ -117,8 +136,7 @@ static int hash_set(char *filename, struct hash *ptr, int ch, int hash_index, va
 
 	int hi, lo; // nibbles
 	{
-		char str[2] = {ch, '\0'};
-		int nibble = strtoul(str, NULL, 16);
+		int nibble = (isdigit(ch) ? ch - '0' : tolower(ch) - 'a' + 10);
 		if (hash_index % 2 == 0) {
 			hi = nibble;
 			lo = ptr->md_value[hash_index/2] & 0x0f;
@@ -152,7 +170,400 @@ static char count_end()
 }
 #endif /* (VAMPIRE_NUMBER_OUTPUTS) && (VAMPIRE_HASH) */
 
-int load_checkpoint(struct options_t options, struct interval_t *interval, struct taskboard *progress)
+/*
+ * Task checkpoint:
+ *
+ * 	With TASK_CHECKPOINT the writer also saves the tasks after complete,
+ * running or not, to [checkpoint].tasks: their bounds, their state, the
+ * pieces that have been finished and their raw results. The file is binary,
+ * and is rewritten as a whole to [checkpoint].tasks.tmp, which then replaces
+ * it, so it's never left half written.
+ *
+ * 	The tasks that completed out of order, and wait for the ones before
+ * them, are saved as done, with their final counts and results, so only the
+ * gaps between them are checked again. A result that was moved to the spill
+ * file isn't copied back for this, its task is checked again too.
+ *
+ * 	It's only valid together with the checkpoint lines up to complete, or
+ * up to the end of one of its tasks, a restart may happen anywhere in between.
+ */
+
+#define TASKS_MAGIC "helsing tasks 2\n"
+
+enum task_state
+{
+	task_redo, // Checked again from the start
+	task_running, // Only the pieces that aren't finished are checked
+	task_done // Goes straight to the writer
+};
+
+struct tasks_header
+{
+	char magic[sizeof(TASKS_MAGIC)];
+	uint16_t base;
+	uint8_t vamp_size;
+	uint8_t fang_size;
+	uint32_t count_size;
+	bool numbers;
+};
+
+static void tasks_header(struct tasks_header *ptr)
+{
+	memset(ptr, 0, sizeof(*ptr)); // Padding included
+	memcpy(ptr->magic, TASKS_MAGIC, sizeof(TASKS_MAGIC));
+	ptr->base = BASE;
+	ptr->vamp_size = sizeof(vamp_t);
+	ptr->fang_size = sizeof(fang_t);
+	ptr->count_size = COUNT_ARRAY_SIZE;
+	ptr->numbers = VAMPIRE_NUMBER_OUTPUTS;
+}
+
+static char *checkpoint_path(const char *checkpoint, const char *suffix)
+{
+	char *ret = malloc(strlen(checkpoint) + strlen(suffix) + 1);
+	if (ret == NULL)
+		abort();
+
+	strcpy(ret, checkpoint);
+	strcat(ret, suffix);
+	return ret;
+}
+
+/*
+ * checkpoint_replace:
+ *
+ * 	Closes tmp and renames it over path, after flushing it to the disk.
+ * The directory is synced too, so that the rename itself survives a power
+ * loss. Without POSIX only the rename is done.
+ */
+
+static int checkpoint_replace(FILE *tmp_fp, const char *tmp, const char *path)
+{
+	int rc = (fflush(tmp_fp) != 0);
+#if (__has_include("unistd.h"))
+	rc |= (fsync(fileno(tmp_fp)) != 0);
+#endif
+	rc |= (fclose(tmp_fp) != 0);
+	if (rc)
+		return rc;
+	rc = (rename(tmp, path) != 0);
+
+#if (__has_include("unistd.h"))
+	char *dir = checkpoint_path(path, "");
+	char *slash = strrchr(dir, '/');
+	if (slash == NULL)
+		strcpy(dir, ".");
+	else if (slash == dir)
+		slash[1] = '\0';
+	else
+		slash[0] = '\0';
+
+	int fd = open(dir, O_RDONLY);
+	if (fd >= 0) {
+		fsync(fd); // Not every file system can sync a directory
+		close(fd);
+	}
+	free(dir);
+#endif
+	return rc;
+}
+
+static int piece_write(FILE *fp, const struct piece *piece)
+{
+	int rc = 0;
+	rc |= (fwrite(&(piece->lmin), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fwrite(&(piece->lmax), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fwrite(&(piece->fmin), sizeof(fang_t), 1, fp) != 1);
+	rc |= (fwrite(&(piece->fmax), sizeof(fang_t), 1, fp) != 1);
+	return rc;
+}
+
+static int piece_read(FILE *fp, struct piece *piece)
+{
+	int rc = 0;
+	rc |= (fread(&(piece->lmin), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fread(&(piece->lmax), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fread(&(piece->fmin), sizeof(fang_t), 1, fp) != 1);
+	rc |= (fread(&(piece->fmax), sizeof(fang_t), 1, fp) != 1);
+	return rc;
+}
+
+/*
+ * task_state:
+ *
+ * 	A complete task is done, unless its result was spilled. A task that's
+ * neither complete nor running has handed its last piece back, but hasn't
+ * reached the writer yet, and is checked again. Requires the write mutex.
+ */
+
+static enum task_state task_state(struct task *task)
+{
+	if (atomic_load(&(task->complete)))
+		return (task->spill < 0 ? task_done : task_redo);
+	if (atomic_load(&(task->pieces)) > 0)
+		return task_running;
+	return task_redo;
+}
+
+static int task_write(FILE *fp, struct task *task, enum task_state state)
+{
+	static const vamp_t zero[COUNT_ARRAY_SIZE] = {0};
+	bool keep = (state != task_redo);
+	uint8_t state_byte = state;
+	double runtime = (keep ? task->runtime : 0.0);
+	size_t finished = (state == task_running ? task->finished_count : 0);
+	bool has_result = (keep && task->result != NULL && VAMPIRE_NUMBER_OUTPUTS);
+
+	int rc = 0;
+	rc |= (fwrite(&(task->lmin), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fwrite(&(task->lmax), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fwrite(&state_byte, sizeof(state_byte), 1, fp) != 1);
+	rc |= (fwrite(&runtime, sizeof(runtime), 1, fp) != 1);
+	rc |= (fwrite((keep ? task->count : zero), sizeof(vamp_t), COUNT_ARRAY_SIZE, fp) != COUNT_ARRAY_SIZE);
+	rc |= (fwrite(&finished, sizeof(finished), 1, fp) != 1);
+	for (size_t i = 0; i < finished; i++)
+		rc |= piece_write(fp, &(task->finished[i]));
+	rc |= (fwrite(&has_result, sizeof(has_result), 1, fp) != 1);
+	if (has_result)
+		rc |= array_save(task->result, fp);
+	return rc;
+}
+
+static int task_read(FILE *fp, struct task *task)
+{
+	size_t finished = 0;
+	bool has_result = false;
+	uint8_t state_byte = task_redo;
+
+	int rc = 0;
+	rc |= (fread(&(task->lmin), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fread(&(task->lmax), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fread(&state_byte, sizeof(state_byte), 1, fp) != 1);
+	rc |= (state_byte > task_done);
+	atomic_store(&(task->complete), (state_byte == task_done));
+	rc |= (fread(&(task->runtime), sizeof(task->runtime), 1, fp) != 1);
+	rc |= (fread(task->count, sizeof(vamp_t), COUNT_ARRAY_SIZE, fp) != COUNT_ARRAY_SIZE);
+	rc |= (fread(&finished, sizeof(finished), 1, fp) != 1);
+	for (size_t i = 0; !rc && i < finished; i++) {
+		struct piece piece;
+		rc |= piece_read(fp, &piece);
+		task_add_finished(task, &piece);
+	}
+	rc |= (fread(&has_result, sizeof(has_result), 1, fp) != 1);
+	if (!rc && has_result)
+		rc |= array_load(&(task->result), fp);
+	return rc;
+}
+
+/*
+ * save_tasks:
+ *
+ * 	Saves the tasks from #done to #todo, see Task checkpoint. It stops at
+ * the first task that has been claimed but isn't set up yet, rather than wait
+ * for it with the write mutex held; that task and the ones after it are then
+ * checked again. Requires the write mutex, so that no piece is copied back
+ * meanwhile.
+ */
+
+void save_tasks(struct options_t options, struct taskboard *progress)
+{
+	if (!progress->task_checkpoint)
+		return;
+
+	char *path = checkpoint_path(options.checkpoint, ".tasks");
+	char *tmp = checkpoint_path(options.checkpoint, ".tasks.tmp");
+	size_t todo = atomic_load(&(progress->todo));
+	size_t count = 0;
+	for (size_t i = progress->done; i < todo; i++) {
+		struct task *task = &(progress->tasks[i % progress->ring]);
+		if (!atomic_load(&(task->ready))) {
+			todo = i;
+			break;
+		}
+		if (task->lmin <= task->lmax)
+			count++;
+	}
+
+	int rc = 1;
+	FILE *fp = fopen(tmp, "wb");
+	if (fp == NULL)
+		goto out;
+
+	struct tasks_header header;
+	tasks_header(&header);
+	rc = 0;
+	rc |= (fwrite(&header, sizeof(header), 1, fp) != 1);
+	rc |= (fwrite(&(progress->complete), sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fwrite(&count, sizeof(count), 1, fp) != 1);
+	for (size_t i = progress->done; i < todo; i++) {
+		struct task *task = &(progress->tasks[i % progress->ring]);
+		if (task->lmin <= task->lmax)
+			rc |= task_write(fp, task, task_state(task));
+	}
+	if (rc)
+		fclose(fp);
+	else
+		rc = checkpoint_replace(fp, tmp, path);
+out:
+	if (rc)
+		fprintf(stderr, "Can't save the tasks to %s\n", path);
+	free(path);
+	free(tmp);
+}
+
+/*
+ * load_tasks:
+ *
+ * 	Loads the saved tasks that come after complete. A file that doesn't
+ * match the checkpoint or the build is left out with a warning, its tasks
+ * are then simply checked again.
+ */
+
+static void load_tasks(struct options_t options, vamp_t complete, struct taskboard *progress)
+{
+	if (!progress->task_checkpoint)
+		return;
+
+	char *path = checkpoint_path(options.checkpoint, ".tasks");
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) {
+		free(path);
+		return;
+	}
+
+	struct tasks_header header;
+	struct tasks_header expected;
+	tasks_header(&expected);
+	vamp_t saved_complete = 0;
+	size_t count = 0;
+	struct task *tasks = NULL;
+	size_t loaded = 0;
+
+	int rc = 0;
+	rc |= (fread(&header, sizeof(header), 1, fp) != 1);
+	rc |= (memcmp(&header, &expected, sizeof(header)) != 0);
+	rc |= (fread(&saved_complete, sizeof(vamp_t), 1, fp) != 1);
+	rc |= (fread(&count, sizeof(count), 1, fp) != 1);
+	if (rc)
+		goto out;
+
+	// Every task takes at least this much of the file, see task_write.
+	const size_t task_min = sizeof(vamp_t) * (2 + COUNT_ARRAY_SIZE) + sizeof(uint8_t) + sizeof(double) + sizeof(size_t) + sizeof(bool);
+	long start = ftell(fp);
+	rc |= (start < 0 || fseek(fp, 0, SEEK_END) != 0);
+	long end = rc ? -1 : ftell(fp);
+	rc |= (end < start || fseek(fp, start, SEEK_SET) != 0);
+	rc |= (!rc && count > (size_t)(end - start) / task_min);
+	rc |= (count > SIZE_MAX / sizeof(struct task));
+	if (rc)
+		goto out;
+
+	tasks = malloc(sizeof(struct task) * count);
+	if (tasks == NULL && count > 0) {
+		rc = 1;
+		goto out;
+	}
+
+	for (; loaded < count && !rc; loaded++) {
+		struct task *task = &(tasks[loaded]);
+		memset(task, 0, sizeof(struct task));
+		task_clear(task);
+		task->spill = -1;
+		rc |= task_read(fp, task);
+	}
+	if (rc)
+		goto out;
+
+	// Skip the tasks that made it to the checkpoint after the save.
+	size_t first = 0;
+	while (first < count && saved_complete != complete)
+		saved_complete = tasks[first++].lmax;
+	if (saved_complete != complete) {
+		rc = 1;
+		goto out;
+	}
+
+	progress->restored_count = count - first;
+	progress->restored = malloc(sizeof(struct task) * progress->restored_count);
+	if (progress->restored == NULL && progress->restored_count > 0)
+		abort();
+	memcpy(progress->restored, &(tasks[first]), sizeof(struct task) * progress->restored_count);
+	loaded = first;
+out:
+	if (rc)
+		fprintf(stderr, "%s doesn't match the checkpoint, the tasks after it are checked again\n", path);
+	for (size_t i = 0; i < loaded; i++)
+		task_clear(&(tasks[i]));
+	free(tasks);
+	fclose(fp);
+	free(path);
+}
+
+/*
+ * checkpoint_read:
+ *
+ * Reads the whole file into memory, in blocks. Returns NULL on an I/O error.
+ */
+
+static char *checkpoint_read(FILE *fp, size_t *size)
+{
+	size_t capacity = BUFSIZ;
+	char *ret = malloc(capacity);
+	if (ret == NULL)
+		abort();
+
+	*size = 0;
+	size_t len;
+	while ((len = fread(ret + *size, 1, capacity - *size, fp)) > 0) {
+		*size += len;
+		if (*size < capacity)
+			continue;
+		capacity *= 2;
+		ret = realloc(ret, capacity);
+		if (ret == NULL)
+			abort();
+	}
+	if (ferror(fp)) {
+		free(ret);
+		ret = NULL;
+	}
+	return ret;
+}
+
+static void head_add(struct taskboard *progress, const char *str, size_t size)
+{
+	if (size == 0)
+		return;
+
+	progress->head = realloc(progress->head, progress->head_size + size);
+	if (progress->head == NULL)
+		abort();
+
+	memcpy(progress->head + progress->head_size, str, size);
+	progress->head_size += size;
+}
+
+static void tail_set(struct taskboard *progress, const char *str, size_t size)
+{
+	progress->tail = realloc(progress->tail, size);
+	if (progress->tail == NULL && size > 0)
+		abort();
+
+	if (size > 0)
+		memcpy(progress->tail, str, size);
+	progress->tail_size = size;
+}
+
+/*
+ * load_checkpoint:
+ *
+ * 	Parses and checks every line of the checkpoint, from a copy of it in
+ * memory. The header and the lines that are kept as history go to
+ * progress->head, and the last line to progress->tail, for save_checkpoint.
+ * A checkpoint that wasn't compacted is compacted the first time it's saved.
+ */
+
+int load_checkpoint(struct options_t options, struct interval_t *interval, struct alphabet *digits, struct taskboard *progress)
 {
 	assert(progress != NULL);
 	if (options.checkpoint == NULL)
@@ -164,24 +575,41 @@ int load_checkpoint(struct options_t options, struct interval_t *interval, struc
 		return 1;
 	}
 
+	size_t size = 0;
+	char *buffer = checkpoint_read(fp, &size);
+	fclose(fp);
+	if (buffer == NULL) {
+		err_baditem(options.checkpoint, 1, 1);
+		fprintf(stderr, "Unexpected end of file, caused by I/O error.\n");
+		return 1;
+	}
+
 	int rc = 0;
 
-	enum types {integer, hash};
-	enum names {min, max, complete, count, checksum = count + FANG_PAIRS_SIZE};
+	enum types {integer, text, hash};
+	enum names {min, max, alphabet, complete, count, checksum = count + FANG_PAIRS_SIZE};
 
-	char end_char[4 + FANG_PAIRS_SIZE] = {' ', '\n', ' '};
+	/*
+	 * The first line is "min max", optionally followed by the digit
+	 * alphabet; max may end with either a space or a newline.
+	 */
+	char end_char[checksum + 1] = {' ', ' ', '\n', ' '};
 
 	// pls compiler no complain
 	volatile size_t fang_pairs_size = FANG_PAIRS_SIZE;
 	for (size_t i = 0; i < fang_pairs_size - 1; i++)
-		end_char[3 + i] = ' ';
-	end_char[2 + FANG_PAIRS_SIZE] = count_end();
-	end_char[3 + FANG_PAIRS_SIZE] = '\n';
+		end_char[count + i] = ' ';
+	end_char[count + FANG_PAIRS_SIZE - 1] = count_end();
+	end_char[checksum] = '\n';
 
-	int type[4 + FANG_PAIRS_SIZE] = {integer, integer, integer};
+	int type[checksum + 1] = {integer, integer, text, integer};
 	for (size_t i = 0; i < FANG_PAIRS_SIZE; i++)
-		type[3 + i] = integer;
-	type[3 + FANG_PAIRS_SIZE] = hash;
+		type[count + i] = integer;
+	type[checksum] = hash;
+
+	char text_buffer[ALPHABET_TEXT_LENGTH + 1];
+	size_t text_index = 0;
+	bool has_alphabet = false;
 
 	int name = min;
 	vamp_t line = 1;
@@ -190,11 +618,12 @@ int load_checkpoint(struct options_t options, struct interval_t *interval, struc
 	bool is_empty = true;
 	vamp_t num = 0;
 	int hash_index = 0;
+	size_t line_start = 0;
+	size_t last_start = 0; // The line before
+	vamp_t last_complete = 0;
 
-	while (!rc) {
-		int ch = fgetc(fp);
-
-		if (feof(fp)) {
+	for (size_t pos = 0; !rc; pos++) {
+		if (pos == size) {
 			if (name != complete || !is_empty) {
 				err_baditem(options.checkpoint, line, item);
 				fprintf(stderr, "Unexpected end of file or missing newline.\n");
@@ -202,14 +631,9 @@ int load_checkpoint(struct options_t options, struct interval_t *interval, struc
 			}
 			break;
 		}
-		if (ferror(fp)) {
-			err_baditem(options.checkpoint, line, item);
-			fprintf(stderr, "Unexpected end of file, caused by I/O error.\n");
-			rc = 1;
-			break;
-		}
+		int ch = (unsigned char)buffer[pos];
 
-		if (ch == end_char[name]) {
+		if (ch == end_char[name] || (name == max && ch == '\n')) {
 			switch (name) {
 				case min:
 					options.min = num;
@@ -230,6 +654,25 @@ int load_checkpoint(struct options_t options, struct interval_t *interval, struc
 					}
 					break;
 
+				case alphabet: {
+					struct alphabet tmp;
+					text_buffer[text_index] = '\0';
+					if (text_index == 0 || alphabet_set(&tmp, text_buffer)) {
+						err_baditem(options.checkpoint, line, item);
+						fprintf(stderr, "Bad digit alphabet.\n");
+						rc = 1;
+					}
+					else if (digits->restricted && !alphabet_equal(&tmp, digits)) {
+						err_conflict(options.checkpoint, line, item);
+						fprintf(stderr, "The digit alphabet differs from -d\n");
+						rc = 1;
+					} else {
+						*digits = tmp;
+						has_alphabet = true;
+					}
+					break;
+				}
+
 				case complete:
 					if (num < interval->min) {
 						err_conflict(options.checkpoint, line, item);
@@ -306,6 +749,7 @@ int load_checkpoint(struct options_t options, struct interval_t *interval, struc
 			}
 			num = 0;
 			hash_index = 0;
+			text_index = 0;
 			is_empty = true;
 			name++;
 			item++;
@@ -316,43 +760,115 @@ int load_checkpoint(struct options_t options, struct interval_t *interval, struc
 					is_empty = false;
 					break;
 
+				case text:
+					if (text_index == ALPHABET_TEXT_LENGTH) {
+						err_unexpected_char(options.checkpoint, ch, line, item);
+						fprintf(stderr, "The digit alphabet is too long.\n");
+						rc = 1;
+					} else {
+						text_buffer[text_index++] = ch;
+					}
+					is_empty = false;
+					break;
+
 				case hash:
 					rc = hash_set(options.checkpoint, progress->checksum, ch, hash_index++, line, item);
 					is_empty = false;
 					break;
 			}
 		}
+		if (ch == '\n' && line == 1) {
+			head_add(progress, buffer, pos + 1);
+		} else if (ch == '\n') {
+			// Keep the last line of every digit length, see CHECKPOINT_HISTORY.
+			if (CHECKPOINT_HISTORY && line > 2 && length(interval->complete) > length(last_complete))
+				head_add(progress, &(buffer[last_start]), line_start - last_start);
+			last_start = line_start;
+			last_complete = interval->complete;
+		}
 		if (ch == '\n') {
+			line_start = pos + 1;
 			name = complete;
 			line++;
 			item = 1;
 		}
 	}
-	fclose(fp);
+	if (!rc && digits->restricted && !has_alphabet) {
+		fprintf(stderr, "\n[ERROR] %s has no digit alphabet, but -d was given\n", options.checkpoint);
+		rc = 1;
+	}
+	if (!rc && line > 2)
+		tail_set(progress, &(buffer[last_start]), size - last_start);
+	free(buffer);
+	if (!rc)
+		load_tasks(options, interval->complete, progress);
 	return rc;
 }
 
+/*
+ * save_checkpoint:
+ *
+ * 	Rewrites the checkpoint as the header, the history and the new line,
+ * so it doesn't grow with the length of the run, see CHECKPOINT_HISTORY. The
+ * line is formatted in memory and kept as progress->tail, it becomes history
+ * once the next line is of a longer length. The
+ * file is written to [checkpoint].tmp first, and replaces the checkpoint once
+ * it's on the disk, so that a crash leaves either the old file or the new
+ * one, never a torn line. How often this happens is up to the taskboard, see
+ * CHECKPOINT_SECONDS.
+ */
+
 void save_checkpoint(struct options_t options, vamp_t complete, struct taskboard *progress)
 {
 	if (options.checkpoint == NULL)
 		return;
 
-	FILE *fp = fopen(options.checkpoint, "a");
-	assert(fp != NULL);
+	OPTIONAL_ASSERT(progress->head != NULL);
+	if (CHECKPOINT_HISTORY && length(complete) > length(progress->saved))
+		head_add(progress, progress->tail, progress->tail_size);
+
+	char *line = NULL;
+	size_t size = 0;
+	FILE *ms = open_memstream(&line, &size);
+	if (ms == NULL)
+		abort();
 
-	helsing_fprint(fp, "v", complete);
+	helsing_fprint(ms, "v", complete);
 	for (size_t i = 0; i < FANG_PAIRS_SIZE; i++)
-		helsing_fprint(fp, "sv", " ", progress->common_count[i]);
+		helsing_fprint(ms, "sv", " ", progress->common_count[i]);
 
 
 #if (VAMPIRE_NUMBER_OUTPUTS) && (VAMPIRE_HASH)
-	fprintf(fp, " ");
+	fprintf(ms, " ");
 	for (int i = 0; i < progress->checksum->md_size; i++)
-		fprintf(fp, "%02x", progress->checksum->md_value[i]);
+		fprintf(ms, "%02x", progress->checksum->md_value[i]);
 #endif
 
-	fprintf(fp, "\n");
-	fclose(fp);
+	fprintf(ms, "\n");
+	if (fclose(ms) != 0)
+		abort();
+	tail_set(progress, line, size);
+	free(line);
+
+	char *tmp = checkpoint_path(options.checkpoint, ".tmp");
+	int rc = 1;
+	FILE *fp = fopen(tmp, "w");
+	if (fp == NULL)
+		goto out;
+
+	rc = (fwrite(progress->head, 1, progress->head_size, fp) != progress->head_size);
+	rc |= (fwrite(progress->tail, 1, progress->tail_size, fp) != progress->tail_size);
+	rc |= (ferror(fp) != 0);
+	if (!rc) {
+		rc = checkpoint_replace(fp, tmp, options.checkpoint);
+		fp = NULL;
+	}
+out:
+	if (rc)
+		fprintf(stderr, "Can't save the checkpoint to %s\n", options.checkpoint);
+	if (fp != NULL)
+		fclose(fp);
+	free(tmp);
 }
 
 #endif /* USE_CHECKPOINT */
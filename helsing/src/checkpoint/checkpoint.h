@@ -11,11 +11,13 @@
 #include "taskboard.h"
 #include "options.h"
 #include "interval.h"
+#include "alphabet.h"
 
 #if USE_CHECKPOINT
 int touch_checkpoint(struct options_t options, struct interval_t interval);
-int load_checkpoint(struct options_t options, struct interval_t *interval, struct taskboard *progress);
+int load_checkpoint(struct options_t options, struct interval_t *interval, struct alphabet *digits, struct taskboard *progress);
 void save_checkpoint(struct options_t options, vamp_t complete, struct taskboard *progress);
+void save_tasks(struct options_t options, struct taskboard *progress);
 #else /* USE_CHECKPOINT */
 static inline int touch_checkpoint(
 	ATTR_UNUSED struct options_t options,
@@ -26,6 +28,7 @@ static inline int touch_checkpoint(
 static inline int load_checkpoint(
 	ATTR_UNUSED struct options_t options,
 	ATTR_UNUSED struct interval_t *interval,
+	ATTR_UNUSED struct alphabet *digits,
 	ATTR_UNUSED struct taskboard *progress)
 {
 	return 0;
@@ -36,5 +39,10 @@ static inline void save_checkpoint(
 	ATTR_UNUSED struct taskboard *progress)
 {
 }
+static inline void save_tasks(
+	ATTR_UNUSED struct options_t options,
+	ATTR_UNUSED struct taskboard *progress)
+{
+}
 #endif /* USE_CHECKPOINT */
 #endif /* HELSING_CHECKPOINT_H */
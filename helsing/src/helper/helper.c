@@ -92,6 +92,33 @@ vamp_t div_roof(vamp_t x, vamp_t y)
 	return (x/y + !!(x%y));
 }
 
+fang_t sqrtv_floor(vamp_t x) // vamp_t sqrt to fang_t.
+{
+	vamp_t x2 = x / 2;
+	vamp_t root = x2;
+	if (root > 0) {
+		vamp_t tmp = (root + x / root) / 2;
+		while (tmp < root) {
+			root = tmp;
+			tmp = (root + x / root) / 2;
+		}
+		return root;
+	}
+	return x;
+}
+
+fang_t sqrtv_roof(vamp_t x)
+{
+	if (x == 0)
+		return 0;
+
+	fang_t root = sqrtv_floor(x);
+	if (root == FANG_MAX())
+		return root;
+
+	return (x / root);
+}
+
 /*
  * helsing_fprint:
  * 	'a':	bimax_t
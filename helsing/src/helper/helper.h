@@ -7,6 +7,7 @@
 #define HELSING_HELPER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "configuration_adv.h"
@@ -20,6 +21,25 @@ ATTR_CONST vamp_t pow_v(length_t exponent);
 vamp_t get_min(vamp_t min, vamp_t max);
 vamp_t get_max(vamp_t min, vamp_t max);
 ATTR_CONST vamp_t div_roof(vamp_t x, vamp_t y);
+ATTR_CONST fang_t sqrtv_floor(vamp_t x);
+ATTR_CONST fang_t sqrtv_roof(vamp_t x);
 void helsing_fprint(FILE *fp, char *formats, ...);
 
+/*
+ * Without a popcount instruction __builtin_popcountll is a library call, the
+ * bit counting below is faster.
+ */
+
+static inline length_t popcount64(uint64_t x)
+{
+#if ((__GNUC__ || __clang__) && defined(__POPCNT__))
+	return __builtin_popcountll(x);
+#else
+	x -= (x >> 1) & UINT64_C(0x5555555555555555);
+	x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+	x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+	return ((x * UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
 #endif /* HELPER_HELSING */
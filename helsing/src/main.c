@@ -5,8 +5,6 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
-#include <threads.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
@@ -16,16 +14,7 @@
 #include "checkpoint.h"
 #include "interval.h"
 #include "options.h"
-
-static vamp_t get_lmax(vamp_t lmin, vamp_t max)
-{
-	if (length(lmin) < length(VAMP_MAX())) {
-		vamp_t lmax = pow_v(length(lmin)) - 1;
-		if (lmax < max)
-			return lmax;
-	}
-	return max;
-}
+#include "binary.h"
 
 int main(int argc, char *argv[])
 {
@@ -37,6 +26,10 @@ int main(int argc, char *argv[])
 	rc = options_new(&options, argc, argv);
 	if (rc)
 		goto out;
+	if (options->decode != NULL) {
+		rc = binary_decode(options->decode);
+		goto out;
+	}
 	rc = interval_set(&interval, *options);
 	if (rc)
 		goto out;
@@ -47,32 +40,31 @@ int main(int argc, char *argv[])
 
 	taskboard_new(&progress, *options);
 
-	if (load_checkpoint(*options, &interval, progress))
+	if (load_checkpoint(*options, &interval, &(options->digits), progress))
 		goto out;
 
-	thrd_t *threads = malloc(sizeof(thrd_t) * options->threads);
-	if (threads == NULL)
-		abort();
 	struct targs_handle *thhandle = NULL;
 	targs_handle_new(&thhandle, *options, interval.min, interval.max, progress);
 
-	vamp_t lmin = 0, lmax = 0;
-	for (; interval.complete < interval.max; interval.complete = lmax) {
-		lmin = get_min(interval.complete + 1,  interval.max);
-		lmax = get_lmax(lmin, interval.max);
-		taskboard_set(progress, lmin, lmax);
-		if (progress->size == 0)
-			continue;
-
-		helsing_fprint(stderr, "svsvs",  "Checking interval: [", lmin, ", ", lmax, "]\n");
-		for (thread_t thread = 0; thread < options->threads; thread++)
-			assert(thrd_create(&threads[thread], thread_function, (void *)(thhandle->targs[thread])) == thrd_success);
-		for (thread_t thread = 0; thread < options->threads; thread++)
-			thrd_join(threads[thread], 0);
+	taskboard_set(progress, interval.complete, interval.max);
+	if (options->format == format_binary)
+		binary_header(stdout);
+	if (progress->size > 0)
+		targs_handle_run(thhandle);
+	if (atomic_load(&(progress->stop))) {
+		helsing_fprint(stderr, "svs", "Stopped, everything up to ", progress->complete, " is done");
+		if (options->checkpoint != NULL)
+			fprintf(stderr, ", continue with -c %s", options->checkpoint);
+		fprintf(stderr, "\n");
+		rc = 1;
+		if (thhandle->forced) {
+			fflush(stdout);
+			_Exit(rc); // The workers are still running
+		}
+	} else {
+		targs_handle_print(thhandle);
 	}
-	targs_handle_print(thhandle);
 	targs_handle_free(thhandle);
-	free(threads);
 out:
 	taskboard_free(progress);
 	options_free(options);
@@ -48,16 +48,37 @@ static void buildconf()
 		printf("        MULTIPLICAND_PARTITIONS=%d\n", MULTIPLICAND_PARTITIONS);
 		printf("        PRODUCT_PARTITIONS=%d\n", PRODUCT_PARTITIONS);
 	}
+	printf("    ALG_SWAR=%s\n", (ALG_SWAR ? "true" : "false"));
+	if (ALG_SWAR)
+		printf("        SWAR_MIN_LENGTH=%d\n", SWAR_MIN_LENGTH);
+	printf("    ALG_BITS=%s\n", (ALG_BITS ? "true" : "false"));
+	if (ALG_BITS)
+		printf("        ALG_BITS_ACTIVE=%s\n", (ALG_BITS_ACTIVE ? "true" : "false"));
 	#ifdef VAMPIRE_BITS
-		printf("    VAMPIRE_BITS=%d", VAMPIRE_BITS);
+		printf("    VAMPIRE_BITS=%d\n", VAMPIRE_BITS);
 	#endif
 	printf("    BASE=%d\n", BASE);
-	helsing_fprint(stdout, "sas"
+	helsing_fprint(stdout, "sas",
 	       "    MAX_TASK_SIZE=", (bimax_t)(MAX_TASK_SIZE), "\n");
+	printf("    TASKBOARD_WINDOW=%d\n", TASKBOARD_WINDOW);
+	printf("    REORDER_SPILL=%s\n", (REORDER_SPILL ? "true" : "false"));
+	printf("    WORK_STEALING=%s\n", (WORK_STEALING ? "true" : "false"));
+	if (WORK_STEALING) {
+		printf("        STEAL_DEPTH=%d\n", STEAL_DEPTH);
+		printf("        SPLIT_MULTIPLIERS=%s\n", (SPLIT_MULTIPLIERS ? "true" : "false"));
+	}
+	printf("    MULTIPLIER_TASKS=%s\n", (MULTIPLIER_TASKS ? "true" : "false"));
+	printf("    MEMORY_CELLS=%d\n", MEMORY_CELLS);
+	printf("    RUN_POLL=%d\n", RUN_POLL);
 	printf("    USE_CHECKPOINT=%s\n", (USE_CHECKPOINT ? "true" : "false"));
+	if (USE_CHECKPOINT) {
+		printf("        CHECKPOINT_SECONDS=%d\n", CHECKPOINT_SECONDS);
+		printf("        CHECKPOINT_TASKS=%d\n", CHECKPOINT_TASKS);
+		printf("        CHECKPOINT_HISTORY=%s\n", (CHECKPOINT_HISTORY ? "true" : "false"));
+		printf("        TASK_CHECKPOINT=%d\n", TASK_CHECKPOINT);
+	}
 	printf("    LINK_SIZE=%d\n", LINK_SIZE);
 	printf("    LLMSENTENCE_LIMIT=%d\n", LLMSENTENCE_LIMIT);
-	printf("    TASKBOARD_LIMIT=%d\n", TASKBOARD_LIMIT);
 	printf("    SAFETY_CHECKS=%s\n", (SAFETY_CHECKS ? "true" : "false"));
 }
 
@@ -68,6 +89,30 @@ static void arg_checkpoint()
 #endif
 }
 
+static void arg_affinity()
+{
+	printf("    --affinity [policy]\n");
+	printf("                   pin threads to cpus: none, compact, scatter or physical\n");
+}
+
+static void arg_format()
+{
+	printf("    --format [format]\n");
+	printf("                   print the results as text or binary\n");
+}
+
+static void arg_decode()
+{
+	printf("    --decode [file]\n");
+	printf("                   print a file of binary results as text, - for stdin\n");
+}
+
+static void arg_digits()
+{
+	printf("  -d [digits]      only search fangs made of these digits, or with\n");
+	printf("                   =digits the numbers made of exactly these digits\n");
+}
+
 static void arg_lower_bound()
 {
 	printf("  -l [min]         set interval lower bound\n");
@@ -83,9 +128,38 @@ static void arg_manual_task_size()
 	printf("  -s [task size]   set task size\n");
 }
 
+static void arg_profile()
+{
+	printf("  -p [profile]     learn task costs from, and save them to a profile\n");
+}
+
 static void arg_threads()
 {
-	printf("  -t [threads]     set # of threads\n");
+	printf("  -t [threads]     set # of threads, default: the cpus available to us\n");
+}
+
+static void arg_max_memory()
+{
+	printf("    --max-memory [bytes]\n");
+	printf("                   size tasks to keep the results in memory, with K/M/G\n");
+}
+
+static void arg_threads_file()
+{
+	printf("    --threads-file [file]\n");
+	printf("                   read the # of threads from this file while running,\n");
+	printf("                   up to -t or the cpus online, whichever is more\n");
+}
+
+static void arg_time_limit()
+{
+	printf("    --time-limit [seconds]\n");
+	printf("                   stop after this long, with s/m/h/d\n");
+}
+
+static void arg_window()
+{
+	printf("  -w [window]      set the reorder window, in tasks or with K/M/G in bytes\n");
 }
 
 static void arg_upper_bound()
@@ -102,8 +176,17 @@ static void help()
 	printf("    --help         show help\n");
 	printf("    --progress     display progress\n");
 	printf("    --dry-run      perform a trial run without any calculations\n");
+	arg_affinity();
+	arg_format();
+	arg_decode();
+	arg_max_memory();
+	arg_threads_file();
+	arg_time_limit();
+	arg_digits();
+	arg_profile();
 	arg_manual_task_size();
 	arg_threads();
+	arg_window();
 	printf("\nInterval options:\n");
 	arg_checkpoint();
 	arg_lower_bound();
@@ -111,6 +194,34 @@ static void help()
 	arg_number_of_digits();
 }
 
+// At least 1, when the count isn't available.
+static long cpus_online()
+{
+	long online = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+	online = sysconf(_SC_NPROCESSORS_ONLN);
+#elif defined(_WIN32)
+	SYSTEM_INFO sysinfo;
+	GetSystemInfo(&sysinfo);
+	online = sysinfo.dwNumberOfProcessors;
+#endif
+	if (online < 1)
+		online = 1;
+	return online;
+}
+
+/*
+ * default_threads:
+ *
+ * 	One thread per cpu we may actually use. -t takes precedence over this,
+ * see affinity_threads for the limits that are applied otherwise.
+ */
+
+static thread_t default_threads()
+{
+	return affinity_threads(cpus_online());
+}
+
 static int strtov(const char *str, vamp_t min, vamp_t max, vamp_t *number) // string to vamp_t
 {
 	assert(str != NULL);
@@ -140,6 +251,125 @@ out:
 	return err;
 }
 
+/*
+ * strtobytes:
+ *
+ * A number of bytes, optionally followed by K, M or G (powers of 1024).
+ */
+
+static int strtobytes(const char *str, size_t *bytes)
+{
+	size_t len = 0;
+	for (; isgraph(str[len]); len++);
+
+	int shift = 0;
+	if (len > 0) {
+		switch (toupper(str[len - 1])) {
+			case 'K':
+				shift = 10;
+				break;
+			case 'M':
+				shift = 20;
+				break;
+			case 'G':
+				shift = 30;
+				break;
+			default:
+				break;
+		}
+	}
+	vamp_t tmp;
+	if (shift == 0) {
+		int rc = strtov(str, 1, SIZE_MAX, &tmp);
+		if (!rc)
+			*bytes = tmp;
+		return rc;
+	}
+
+	char *digits = malloc(len);
+	if (digits == NULL)
+		abort();
+	memcpy(digits, str, len - 1);
+	digits[len - 1] = '\0';
+
+	int rc = strtov(digits, 1, SIZE_MAX >> shift, &tmp);
+	if (!rc)
+		*bytes = (size_t)tmp << shift;
+	free(digits);
+	return rc;
+}
+
+/*
+ * strtoseconds:
+ *
+ * A number of seconds, optionally followed by s, m, h or d.
+ */
+
+static int strtoseconds(const char *str, size_t *seconds)
+{
+	size_t len = 0;
+	for (; isgraph(str[len]); len++);
+
+	size_t unit = 0;
+	if (len > 0) {
+		switch (tolower(str[len - 1])) {
+			case 's':
+				unit = 1;
+				break;
+			case 'm':
+				unit = 60;
+				break;
+			case 'h':
+				unit = 60 * 60;
+				break;
+			case 'd':
+				unit = 24 * 60 * 60;
+				break;
+			default:
+				break;
+		}
+	}
+	vamp_t tmp;
+	if (unit == 0) {
+		int rc = strtov(str, 1, SIZE_MAX, &tmp);
+		if (!rc)
+			*seconds = tmp;
+		return rc;
+	}
+
+	char *digits = malloc(len);
+	if (digits == NULL)
+		abort();
+	memcpy(digits, str, len - 1);
+	digits[len - 1] = '\0';
+
+	int rc = strtov(digits, 1, SIZE_MAX / unit, &tmp);
+	if (!rc)
+		*seconds = (size_t)tmp * unit;
+	free(digits);
+	return rc;
+}
+
+/*
+ * strtowindow:
+ *
+ * A number of tasks, or of bytes if it ends in K, M or G.
+ */
+
+static int strtowindow(const char *str, size_t *tasks, size_t *bytes)
+{
+	size_t len = 0;
+	for (; isgraph(str[len]); len++);
+	if (len > 0 && strchr("KMG", toupper(str[len - 1])) != NULL)
+		return strtobytes(str, bytes);
+
+	vamp_t tmp;
+	int rc = strtov(str, 1, SIZE_MAX, &tmp);
+	if (!rc)
+		*tasks = tmp;
+	return rc;
+}
+
 static length_t max_n_digits()
 {
 	length_t ret = 0;
@@ -154,34 +384,101 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 	if (new == NULL)
 		abort();
 
-	new->threads = 1;
+	new->threads = 0; // See default_threads
 	new->manual_task_size = 0;
+	new->window_tasks = 0;
+	new->window_bytes = 0;
+	new->max_memory = 0;
+	new->time_limit = 0;
 	new->display_progress = false;
 	new->dry_run = false;
 	new->min = 0;
 	new->max = 0;
 	new->checkpoint = NULL;
-
-#if defined(_SC_NPROCESSORS_ONLN)
-	new->threads = sysconf(_SC_NPROCESSORS_ONLN);
-#elif defined(_WIN32)
-	SYSTEM_INFO sysinfo;
-	GetSystemInfo(&sysinfo);
-	new->threads = sysinfo.dwNumberOfProcessors;
-#endif
+	new->profile = NULL;
+	new->threads_file = NULL;
+	new->affinity = affinity_none;
+	new->format = format_text;
+	new->decode = NULL;
+	alphabet_init(&(new->digits));
 
 	int rc = 0;
 	static int display_progress = 0;
 	static int dry_run = 0;
 	bool min_is_set = false;
 	bool max_is_set = false;
+	bool digits_is_set = false;
+	bool affinity_is_set = false;
+	bool format_is_set = false;
 
-	enum parametrized_flags {pf_none, pf_c, pf_l, pf_n, pf_s, pf_t, pf_u};
+	enum parametrized_flags {pf_none, pf_affinity, pf_format, pf_decode, pf_max_memory, pf_threads_file, pf_time_limit, pf_c, pf_d, pf_l, pf_n, pf_p, pf_s, pf_t, pf_u, pf_w};
 	int read_parameter = pf_none;
 	for (int i = 1; i < argc; i++) {
 		switch (read_parameter) {
 			case pf_none:
 				break;
+			case pf_affinity:
+				if (affinity_is_set) {
+					help();
+					rc = 1;
+				} else {
+					rc = affinity_set(&(new->affinity), argv[i]);
+					affinity_is_set = true;
+				}
+				break;
+
+			case pf_format:
+				if (format_is_set) {
+					help();
+					rc = 1;
+				} else {
+					rc = format_set(&(new->format), argv[i]);
+					format_is_set = true;
+				}
+				break;
+			case pf_decode:
+				if (new->decode != NULL) {
+					help();
+					rc = 1;
+				} else {
+					size_t len = strlen(argv[i]) + 1;
+					new->decode = malloc(len);
+					if (new->decode == NULL)
+						abort();
+					strcpy(new->decode, argv[i]);
+				}
+				break;
+			case pf_max_memory:
+				if (new->max_memory != 0) {
+					help();
+					rc = 1;
+				} else {
+					rc = strtobytes(argv[i], &(new->max_memory));
+				}
+				break;
+
+			case pf_threads_file:
+				if (new->threads_file != NULL) {
+					help();
+					rc = 1;
+				} else {
+					size_t len = strlen(argv[i]) + 1;
+					new->threads_file = malloc(len);
+					if (new->threads_file == NULL)
+						abort();
+					strcpy(new->threads_file, argv[i]);
+				}
+				break;
+
+			case pf_time_limit:
+				if (new->time_limit != 0) {
+					help();
+					rc = 1;
+				} else {
+					rc = strtoseconds(argv[i], &(new->time_limit));
+				}
+				break;
+
 			case pf_c:
 				if (new->checkpoint != NULL) {
 					help();
@@ -195,6 +492,16 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 				}
 				break;
 
+			case pf_d:
+				if (digits_is_set) {
+					help();
+					rc = 1;
+				} else {
+					rc = alphabet_set(&(new->digits), argv[i]);
+					digits_is_set = true;
+				}
+				break;
+
 			case pf_l:
 				if (min_is_set) {
 					help();
@@ -221,6 +528,19 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 				}
 				break;
 
+			case pf_p:
+				if (new->profile != NULL) {
+					help();
+					rc = 1;
+				} else {
+					size_t len = strlen(argv[i]) + 1;
+					new->profile = malloc(len);
+					if (new->profile == NULL)
+						abort();
+					strcpy(new->profile, argv[i]);
+				}
+				break;
+
 			case pf_s:
 				if (new->manual_task_size != 0) {
 					help();
@@ -254,6 +574,15 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 				}
 				break;
 
+			case pf_w:
+				if (new->window_tasks != 0 || new->window_bytes != 0) {
+					help();
+					rc = 1;
+				} else {
+					rc = strtowindow(argv[i], &(new->window_tasks), &(new->window_bytes));
+				}
+				break;
+
 			default:
 				abort();
 		}
@@ -272,15 +601,39 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 				help();
 				rc = 1;
 			}
+			else if (strcmp(argv[i], "--affinity") == 0) {
+				read_parameter = pf_affinity;
+			}
+			else if (strcmp(argv[i], "--max-memory") == 0) {
+				read_parameter = pf_max_memory;
+			}
+			else if (strcmp(argv[i], "--format") == 0) {
+				read_parameter = pf_format;
+			}
+			else if (strcmp(argv[i], "--decode") == 0) {
+				read_parameter = pf_decode;
+			}
+			else if (strcmp(argv[i], "--threads-file") == 0) {
+				read_parameter = pf_threads_file;
+			}
+			else if (strcmp(argv[i], "--time-limit") == 0) {
+				read_parameter = pf_time_limit;
+			}
 			else if (strcmp(argv[i], "-c") == 0) {
 				read_parameter = pf_c;
 			}
+			else if (strcmp(argv[i], "-d") == 0) {
+				read_parameter = pf_d;
+			}
 			else if (strcmp(argv[i], "-l") == 0) {
 				read_parameter = pf_l;
 			}
 			else if (strcmp(argv[i], "-n") == 0) {
 				read_parameter = pf_n;
 			}
+			else if (strcmp(argv[i], "-p") == 0) {
+				read_parameter = pf_p;
+			}
 			else if (strcmp(argv[i], "-s") == 0) {
 				read_parameter = pf_s;
 			}
@@ -290,6 +643,9 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 			else if (strcmp(argv[i], "-u") == 0) {
 				read_parameter = pf_u;
 			}
+			else if (strcmp(argv[i], "-w") == 0) {
+				read_parameter = pf_w;
+			}
 			else {
 				printf ("non-option ARGV-elements: %s\n", argv[i]);
 			}
@@ -310,11 +666,18 @@ int options_new(struct options_t **ptr, int argc, char *argv[])
 		rc = 1;
 		goto out;
 	}
-	if ((!min_is_set) && (!max_is_set) && (new->checkpoint == NULL)) {
+	if ((!min_is_set) && (!max_is_set) && (new->checkpoint == NULL) && (new->decode == NULL)) {
 		help();
 		rc = 1;
 		goto out;
 	}
+	if (new->threads == 0)
+		new->threads = default_threads();
+	new->threads_active = new->threads;
+	// With --threads-file there are workers for every cpu online, or -t if
+	// that's more, but only threads_active of them run to begin with.
+	if (new->threads_file != NULL && new->threads < cpus_online())
+		new->threads = (cpus_online() < THREAD_T_MAX ? cpus_online() : THREAD_T_MAX);
 	if (display_progress)
 		new->display_progress = true;
 	if (dry_run)
@@ -331,6 +694,9 @@ void options_free(struct options_t *ptr)
 		return;
 
 	free(ptr->checkpoint);
+	free(ptr->profile);
+	free(ptr->threads_file);
+	free(ptr->decode);
 	free(ptr);
 }
 
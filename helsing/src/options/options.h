@@ -9,17 +9,31 @@
 #include <stdbool.h>
 
 #include "configuration_adv.h"
+#include "alphabet.h"
+#include "affinity.h"
+#include "binary.h"
 
 struct options_t
 {
 	vamp_t min;
 	vamp_t max;
-	thread_t threads;
+	thread_t threads; // Size of the pool
+	thread_t threads_active; // Workers that run at first, see --threads-file
+	char *threads_file;
 	size_t manual_task_size;
+	size_t window_tasks; // 0 for the default, see TASKBOARD_WINDOW
+	size_t window_bytes; // 0 for no limit
+	size_t max_memory; // 0 for no limit
+	size_t time_limit; // In seconds, 0 for none
 	bool display_progress;
 	bool load_checkpoint;
 	char *checkpoint;
+	char *profile;
 	bool dry_run;
+	enum affinity affinity;
+	enum output_format format;
+	char *decode; // A stream of results to print as text, see --format
+	struct alphabet digits;
 };
 
 int options_new(struct options_t **ptr, int argc, char *argv[]);
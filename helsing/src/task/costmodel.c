@@ -0,0 +1,383 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+#include "helper.h"
+#include "costmodel.h"
+
+static void profile_load(struct costmodel *ptr)
+{
+	FILE *fp = fopen(ptr->profile, "r");
+	if (fp == NULL)
+		return; // It will be created.
+
+	int base = 0;
+	if (fscanf(fp, " base %d", &base) != 1 || base != BASE) {
+		fprintf(stderr, "Ignoring profile %s: not made for base %d\n", ptr->profile, BASE);
+		goto err;
+	}
+
+	unsigned int len;
+	while (fscanf(fp, " %u", &len) == 1) {
+		if (len >= ptr->lengths) {
+			fprintf(stderr, "Ignoring profile %s: bad length %u\n", ptr->profile, len);
+			goto err;
+		}
+		for (size_t k = 0; k < COST_BUCKETS; k++) {
+			double factor;
+			if (fscanf(fp, " %lf", &factor) != 1 || !(factor > 0.0)) {
+				fprintf(stderr, "Ignoring profile %s: bad factor\n", ptr->profile);
+				goto err;
+			}
+			ptr->factor[len][k] = factor;
+		}
+		ptr->learned[len] = true;
+	}
+	if (!feof(fp)) {
+		fprintf(stderr, "Ignoring profile %s: unexpected data\n", ptr->profile);
+		goto err;
+	}
+	fclose(fp);
+	return;
+err:
+	// Don't learn from, or overwrite, a profile we don't understand.
+	for (length_t i = 0; i < ptr->lengths; i++)
+		ptr->learned[i] = false;
+	ptr->profile = NULL;
+	fclose(fp);
+}
+
+static void profile_save(struct costmodel *ptr)
+{
+	size_t len = strlen(ptr->profile) + sizeof(".tmp");
+	char *tmp = malloc(len);
+	if (tmp == NULL)
+		abort();
+	snprintf(tmp, len, "%s.tmp", ptr->profile);
+
+	FILE *fp = fopen(tmp, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Can't write profile %s\n", tmp);
+		goto out;
+	}
+	fprintf(fp, "base %d\n", BASE);
+	for (length_t i = 0; i < ptr->lengths; i++) {
+		if (!ptr->learned[i])
+			continue;
+		fprintf(fp, "%u", i);
+		for (size_t k = 0; k < COST_BUCKETS; k++)
+			fprintf(fp, " %.4f", ptr->factor[i][k]);
+		fprintf(fp, "\n");
+	}
+	if (fclose(fp) == 0)
+		rename(tmp, ptr->profile);
+out:
+	free(tmp);
+}
+
+void costmodel_new(struct costmodel **ptr, char *profile)
+{
+	OPTIONAL_ASSERT(ptr != NULL);
+	OPTIONAL_ASSERT(*ptr == NULL);
+
+	struct costmodel *new = malloc(sizeof(struct costmodel));
+	if (new == NULL)
+		abort();
+
+	new->profile = profile;
+	new->lengths = length(VAMP_MAX()) + 1;
+
+	new->factor = malloc(sizeof(*(new->factor)) * new->lengths);
+	if (new->factor == NULL)
+		abort();
+
+	new->learned = malloc(sizeof(bool) * new->lengths);
+	if (new->learned == NULL)
+		abort();
+
+	for (length_t i = 0; i < new->lengths; i++) {
+		new->learned[i] = false;
+		for (size_t k = 0; k < COST_BUCKETS; k++)
+			new->factor[i][k] = 1.0;
+	}
+	if (new->profile != NULL)
+		profile_load(new);
+	*ptr = new;
+}
+
+void costmodel_free(struct costmodel *ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	free(ptr->factor);
+	free(ptr->learned);
+	free(ptr);
+}
+
+/*
+ * pairs:
+ *
+ * 	The number of pairs multiplicand <= multiplier <= fmax whose product is
+ * below x. For x <= fmax^2 that's about:
+ * 	integral of min(m, x / m) dm = x / 2 + x * ln(fmax / sqrt(x))
+ */
+
+static double pairs(struct cost_estimate *ptr, double x)
+{
+	if (x <= 1.0)
+		return 0.0;
+	if (x >= ptr->fmax * ptr->fmax)
+		return (ptr->fmax * ptr->fmax / 2.0);
+	return (x / 2.0 + x * (log(ptr->fmax) - log(x) / 2.0));
+}
+
+static size_t bucket(struct cost_estimate *ptr, double x)
+{
+	double k = floor((x - ptr->bucket_min) / ptr->bucket_width);
+	if (k < 0.0)
+		return 0;
+	if (k >= COST_BUCKETS)
+		return (COST_BUCKETS - 1);
+	return k;
+}
+
+static double bucket_start(struct cost_estimate *ptr, size_t k)
+{
+	return (ptr->bucket_min + ptr->bucket_width * k);
+}
+
+static double weighted_pairs(struct cost_estimate *ptr, double x)
+{
+	size_t k = bucket(ptr, x);
+	return (ptr->prefix[k] + ptr->factor[k] * (pairs(ptr, x) - pairs(ptr, bucket_start(ptr, k))));
+}
+
+static double cost_at(struct cost_estimate *ptr, double x)
+{
+	return (weighted_pairs(ptr, x) + ptr->slope * (x - (double)ptr->lmin) - ptr->cost_min);
+}
+
+/*
+ * costmodel_set:
+ *
+ * 	Prepares the estimate of [lmin, lmax], that will be cut into the given
+ * number of tasks, unless they're meant to be of equal width.
+ *
+ * 	Near fmax^2 there are hardly any pairs left, and the tasks there would
+ * grow past MAX_TASK_SIZE. So every number also costs slope, which is set
+ * just high enough that no task can be wider than MAX_TASK_SIZE. If even
+ * that doesn't fit, the tasks fall back to equal width.
+ */
+
+void costmodel_set(struct costmodel *model, struct cost_estimate *ptr, vamp_t lmin, vamp_t lmax, fang_t fmax, size_t tasks, bool equal_width)
+{
+	ptr->model = model;
+	ptr->length = length(lmin);
+	ptr->lmin = lmin;
+	ptr->lmax = lmax;
+	ptr->fmax = fmax;
+	ptr->bucket_min = pow_v(ptr->length - 1);
+	ptr->bucket_width = ptr->bucket_min * (BASE - 1) / COST_BUCKETS;
+	memset(ptr->time, 0, sizeof(ptr->time));
+	memset(ptr->estimate, 0, sizeof(ptr->estimate));
+
+	memcpy(ptr->factor, model->factor[ptr->length], sizeof(ptr->factor));
+	ptr->prefix[0] = 0.0;
+	for (size_t k = 0; k < COST_BUCKETS; k++) {
+		double span = pairs(ptr, bucket_start(ptr, k + 1)) - pairs(ptr, bucket_start(ptr, k));
+		ptr->prefix[k + 1] = ptr->prefix[k] + ptr->factor[k] * span;
+	}
+
+	double width = (double)lmax - (double)lmin + 1.0;
+	double total = weighted_pairs(ptr, (double)lmax + 1.0) - weighted_pairs(ptr, lmin);
+	double limit = (double)tasks * (double)(MAX_TASK_SIZE);
+
+	ptr->slope = 0.0;
+	ptr->equal_width = (equal_width || fmax == 0 || tasks < 2 || !(total > 0.0) || limit <= width);
+	if (!ptr->equal_width)
+		ptr->slope = total / (limit - width);
+
+	ptr->cost_min = 0.0;
+	ptr->cost_min = cost_at(ptr, lmin);
+	ptr->cost_max = cost_at(ptr, (double)lmax + 1.0);
+}
+
+/*
+ * costmodel_progress:
+ *
+ * The estimated work of [lmin, x], as a fraction of [lmin, lmax]. Unlike
+ * the cuts, this leaves out the cost of every number.
+ */
+
+double costmodel_progress(struct cost_estimate *ptr, vamp_t x)
+{
+	double done = weighted_pairs(ptr, (double)x + 1.0) - weighted_pairs(ptr, ptr->lmin);
+	double total = weighted_pairs(ptr, (double)ptr->lmax + 1.0) - weighted_pairs(ptr, ptr->lmin);
+	if (!(total > 0.0))
+		return 1.0;
+	return (done / total);
+}
+
+/*
+ * costmodel_cut:
+ *
+ * Returns the first number of task #index, 0 < index < tasks.
+ * The cuts are monotonic, but neighbouring cuts may be equal.
+ */
+
+vamp_t costmodel_cut(struct cost_estimate *ptr, size_t index, size_t tasks)
+{
+	OPTIONAL_ASSERT(!ptr->equal_width);
+	OPTIONAL_ASSERT(index > 0 && index < tasks);
+
+	double target = ptr->cost_max * index / tasks;
+	double lo = ptr->lmin;
+	double hi = (double)ptr->lmax + 1.0;
+	for (int i = 0; i < 128; i++) {
+		double mid = lo + (hi - lo) / 2.0;
+		if (mid <= lo || mid >= hi)
+			break;
+		if (cost_at(ptr, mid) < target)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	if (hi >= (double)ptr->lmax)
+		return ptr->lmax;
+	vamp_t ret = ceil(hi);
+	if (ret <= ptr->lmin)
+		return (ptr->lmin + 1);
+	return ret;
+}
+
+/*
+ * multiplier_pairs:
+ *
+ * 	The number of pairs in [lmin, lmax] whose multiplier is below m. A
+ * multiplier m >= sqrt(lmin) has about min(m, lmax / m) - lmin / m
+ * multiplicands, so up to sqrt(lmax) that's:
+ * 	m^2 / 2 - lmin / 2 - lmin * ln(m / sqrt(lmin))
+ * and past it, every multiplier adds (lmax - lmin) / m.
+ */
+
+static double multiplier_pairs(struct cost_estimate *ptr, double m)
+{
+	double a = sqrt((double)ptr->lmin);
+	double b = sqrt((double)ptr->lmax + 1.0);
+	if (m <= a)
+		return 0.0;
+
+	double x = (m < b) ? m : b;
+	double ret = x * x / 2.0 - (double)ptr->lmin / 2.0 - (double)ptr->lmin * (log(x) - log(a));
+	if (m > b)
+		ret += ((double)ptr->lmax + 1.0 - (double)ptr->lmin) * (log(m) - log(b));
+	return ret;
+}
+
+/*
+ * costmodel_multiplier_cut:
+ *
+ * Returns the first multiplier of task #index, 0 < index < tasks, when the
+ * tasks are ranges of multipliers in [fmin, fmax], see MULTIPLIER_TASKS.
+ */
+
+fang_t costmodel_multiplier_cut(struct cost_estimate *ptr, fang_t fmin, fang_t fmax, size_t index, size_t tasks)
+{
+	OPTIONAL_ASSERT(index > 0 && index < tasks);
+
+	double target = multiplier_pairs(ptr, (double)fmax + 1.0) * index / tasks;
+	fang_t lo = fmin;
+	fang_t hi = fmax;
+	while (lo < hi) {
+		fang_t mid = lo + (hi - lo) / 2;
+		if (multiplier_pairs(ptr, mid) < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * costmodel_record:
+ *
+ * Spreads the runtime of a task over the buckets it touches, in proportion
+ * to the plain pair count.
+ */
+
+void costmodel_record(struct cost_estimate *ptr, vamp_t lmin, vamp_t lmax, double seconds)
+{
+	if (lmin > lmax || !(seconds > 0.0))
+		return;
+
+	double estimate[COST_BUCKETS] = {0.0};
+	double total = 0.0;
+	double min = lmin;
+	double max = (double)lmax + 1.0;
+	for (size_t k = bucket(ptr, min); k <= bucket(ptr, max) && k < COST_BUCKETS; k++) {
+		double a = bucket_start(ptr, k);
+		double b = bucket_start(ptr, k + 1);
+		if (a < min)
+			a = min;
+		if (b > max)
+			b = max;
+		if (a < b)
+			estimate[k] = pairs(ptr, b) - pairs(ptr, a);
+		total += estimate[k];
+	}
+	if (!(total > 0.0))
+		return;
+
+	for (size_t k = 0; k < COST_BUCKETS; k++) {
+		ptr->time[k] += seconds * estimate[k] / total;
+		ptr->estimate[k] += estimate[k];
+	}
+}
+
+/*
+ * costmodel_learn:
+ *
+ * Replaces the factors of the digit length with the measured time
+ * per pair of each bucket, relative to the average, and saves the profile.
+ */
+
+void costmodel_learn(struct cost_estimate *ptr)
+{
+	struct costmodel *model = ptr->model;
+	if (model->profile == NULL)
+		return;
+
+	double time = 0.0;
+	double estimate = 0.0;
+	for (size_t k = 0; k < COST_BUCKETS; k++) {
+		time += ptr->time[k];
+		estimate += ptr->estimate[k];
+	}
+	if (!(time > 0.0) || !(estimate > 0.0))
+		return;
+
+	double average = time / estimate;
+	double *factor = model->factor[ptr->length];
+	for (size_t k = 0; k < COST_BUCKETS; k++) {
+		if (!(ptr->time[k] > 0.0) || !(ptr->estimate[k] > 0.0))
+			continue;
+		factor[k] = ptr->time[k] / ptr->estimate[k] / average;
+		if (factor[k] < 1.0 / 64.0)
+			factor[k] = 1.0 / 64.0;
+		if (factor[k] > 64.0)
+			factor[k] = 64.0;
+	}
+	model->learned[ptr->length] = true;
+	profile_save(model);
+}
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#ifndef HELSING_COSTMODEL_H
+#define HELSING_COSTMODEL_H
+
+#include <stdbool.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+
+/*
+ * costmodel:
+ *
+ * 	Estimates how much work vampire() has to do for an interval, so that
+ * the taskboard can cut tasks of equal cost instead of equal width.
+ *
+ * 	The estimate is the number of (multiplier, multiplicand) pairs whose
+ * product falls in the interval. Optionally, it's corrected per bucket with
+ * the timings of previous runs, which are kept in a profile file.
+ *
+ * 	Every digit length [BASE^(n-1), BASE^n - 1] is divided into COST_BUCKETS
+ * buckets of equal width, each with a factor that scales the pair count.
+ */
+
+#define COST_BUCKETS 16
+
+struct costmodel
+{
+	char *profile; // NULL if there's no profile to read or write
+	length_t lengths;
+	double (*factor)[COST_BUCKETS]; // indexed by length
+	bool *learned; // indexed by length
+};
+
+/*
+ * cost_estimate:
+ *
+ * The estimate for one digit length [lmin, lmax], and the timings measured
+ * on it so far.
+ */
+
+struct cost_estimate
+{
+	struct costmodel *model;
+	length_t length;
+	vamp_t lmin;
+	vamp_t lmax;
+	double fmax;
+	double factor[COST_BUCKETS];
+	double bucket_min;
+	double bucket_width;
+	double prefix[COST_BUCKETS + 1]; // Weighted pair count below each bucket
+	double slope; // Cost of every number, see costmodel_set
+	bool equal_width;
+	double cost_min;
+	double cost_max;
+
+	double time[COST_BUCKETS];
+	double estimate[COST_BUCKETS];
+};
+
+void costmodel_new(struct costmodel **ptr, char *profile);
+void costmodel_free(struct costmodel *ptr);
+void costmodel_set(struct costmodel *model, struct cost_estimate *ptr, vamp_t lmin, vamp_t lmax, fang_t fmax, size_t tasks, bool equal_width);
+double costmodel_progress(struct cost_estimate *ptr, vamp_t x);
+vamp_t costmodel_cut(struct cost_estimate *ptr, size_t index, size_t tasks);
+fang_t costmodel_multiplier_cut(struct cost_estimate *ptr, fang_t fmin, fang_t fmax, size_t index, size_t tasks);
+void costmodel_record(struct cost_estimate *ptr, vamp_t lmin, vamp_t lmax, double seconds);
+void costmodel_learn(struct cost_estimate *ptr);
+#endif /* HELSING_COSTMODEL_H */
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "configuration.h"
+#include "configuration_adv.h"
+#include "helper.h"
+#include "task.h"
+#include "deque.h"
+
+void deque_new(struct deque **ptr)
+{
+	OPTIONAL_ASSERT(ptr != NULL);
+	OPTIONAL_ASSERT(*ptr == NULL);
+
+	struct deque *new = malloc(sizeof(struct deque));
+	if (new == NULL)
+		abort();
+
+	new->capacity = 16;
+	new->data = malloc(sizeof(struct piece) * new->capacity);
+	if (new->data == NULL)
+		abort();
+
+	new->top = 0;
+	new->size = 0;
+	mtx_init(&(new->mtx), mtx_plain);
+	*ptr = new;
+}
+
+void deque_free(struct deque *ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	mtx_destroy(&(ptr->mtx));
+	free(ptr->data);
+	free(ptr);
+}
+
+void deque_push(struct deque *ptr, struct piece piece)
+{
+	mtx_lock(&(ptr->mtx));
+	if (ptr->size == ptr->capacity) {
+		struct piece *data = malloc(sizeof(struct piece) * ptr->capacity * 2);
+		if (data == NULL)
+			abort();
+
+		for (size_t i = 0; i < ptr->size; i++)
+			data[i] = ptr->data[(ptr->top + i) % ptr->capacity];
+		free(ptr->data);
+		ptr->data = data;
+		ptr->capacity *= 2;
+		ptr->top = 0;
+	}
+	ptr->data[(ptr->top + ptr->size) % ptr->capacity] = piece;
+	ptr->size += 1;
+	mtx_unlock(&(ptr->mtx));
+}
+
+bool deque_pop(struct deque *ptr, struct piece *piece)
+{
+	bool ret = false;
+	mtx_lock(&(ptr->mtx));
+	if (ptr->size > 0) {
+		ptr->size -= 1;
+		*piece = ptr->data[(ptr->top + ptr->size) % ptr->capacity];
+		ret = true;
+	}
+	mtx_unlock(&(ptr->mtx));
+	return ret;
+}
+
+bool deque_steal(struct deque *ptr, struct piece *piece)
+{
+	bool ret = false;
+	mtx_lock(&(ptr->mtx));
+	if (ptr->size > 0) {
+		*piece = ptr->data[ptr->top];
+		ptr->top = (ptr->top + 1) % ptr->capacity;
+		ptr->size -= 1;
+		ret = true;
+	}
+	mtx_unlock(&(ptr->mtx));
+	return ret;
+}
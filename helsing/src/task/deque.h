@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2026 Pierro Zachareas
+ */
+
+#ifndef HELSING_DEQUE_H
+#define HELSING_DEQUE_H
+
+#include <threads.h>
+#include <stdbool.h>
+
+#include "configuration_adv.h"
+#include "task.h"
+
+/*
+ * deque:
+ *
+ * A double ended queue of pieces, one per thread. The owner pushes and pops
+ * at the bottom, other threads steal from the top. The pieces on the top are
+ * the oldest, and usually the biggest.
+ */
+
+struct deque
+{
+	mtx_t mtx;
+	struct piece *data;
+	size_t capacity;
+	size_t top; // index of the oldest piece
+	size_t size;
+};
+
+void deque_new(struct deque **ptr);
+void deque_free(struct deque *ptr);
+void deque_push(struct deque *ptr, struct piece piece);
+bool deque_pop(struct deque *ptr, struct piece *piece);
+bool deque_steal(struct deque *ptr, struct piece *piece);
+#endif /* HELSING_DEQUE_H */
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
@@ -14,40 +15,219 @@
 #include "array.h"
 #include "vargs.h"
 
-void task_new(struct task **ptr, vamp_t lmin, vamp_t lmax)
+/*
+ * task_init:
+ *
+ * 	Sets up a free slot of the taskboard for a new task. complete is left
+ * alone, the writer owns it until the slot is free again, see task_clear.
+ */
+
+void task_init(struct task *ptr, size_t index, vamp_t lmin, vamp_t lmax, fang_t fmin, fang_t fmax)
 {
 	OPTIONAL_ASSERT(ptr != NULL);
-	OPTIONAL_ASSERT(*ptr == NULL);
+	OPTIONAL_ASSERT(ptr->result == NULL);
+	OPTIONAL_ASSERT(ptr->finished_count == 0);
+	OPTIONAL_ASSERT(ptr->complete == false);
 
-	struct task *new = malloc(sizeof(struct task));
-	if (new == NULL)
-		abort();
-
-	new->lmin = lmin;
-	new->lmax = lmax;
-	new->result = NULL;
-	memset(new->count, 0, sizeof(new->count));
-	new->complete = false;
-	*ptr = new;
+	ptr->index = index;
+	ptr->cells = 1;
+	ptr->lmin = lmin;
+	ptr->lmax = lmax;
+	ptr->fmin = fmin;
+	ptr->fmax = fmax;
+	memset(ptr->count, 0, sizeof(ptr->count));
+	atomic_store(&(ptr->pieces), 1);
+	ptr->runtime = 0.0;
+	ptr->bytes = 0;
+	ptr->spill = -1;
 }
 
-void task_free(struct task *ptr)
+// Frees the results and the slot.
+void task_clear(struct task *ptr)
 {
-	if (ptr == NULL)
-		return;
-
 	array_free(ptr->result);
-	free(ptr);
+	ptr->result = NULL;
+	free(ptr->finished);
+	ptr->finished = NULL;
+	ptr->finished_count = 0;
+	ptr->finished_capacity = 0;
+	atomic_store(&(ptr->ready), false);
+	atomic_store(&(ptr->complete), false);
 }
 
-void task_copy_vargs(struct task *ptr, struct vargs *vamp_args)
+/*
+ * task_copy_vargs:
+ *
+ * Adds the results and the runtime of a piece to its task. Returns true once the last piece
+ * has been copied back and the task is complete. Requires mutex lock.
+ *
+ * Without STORE_RESULTS only the counts are needed. A piece that went
+ * through every multiplier of the task found every fang pair of its numbers,
+ * so it's counted right away and its results are dropped. Only the pieces
+ * that split the multipliers are kept, until the task is complete.
+ *
+ * With MULTIPLIER_TASKS the fang pairs of a number can be spread over every
+ * task of the digit length, so the results are finished by the writer.
+ */
+
+bool task_copy_vargs(struct task *ptr, struct vargs *vamp_args, double runtime, const struct piece *piece)
 {
 	OPTIONAL_ASSERT(ptr != NULL);
 	OPTIONAL_ASSERT(vamp_args != NULL);
+	OPTIONAL_ASSERT(piece != NULL);
 
-	ptr->result = vamp_args->result;
-	memcpy(ptr->count, vamp_args->local_count, sizeof(ptr->count));
-	ptr->complete = true;
+#ifndef STORE_RESULTS
+	if (!MULTIPLIER_TASKS && piece->fmin <= ptr->fmin && piece->fmax >= ptr->fmax)
+		array_finish(&(vamp_args->result), &(ptr->count));
+#endif
+
+	array_merge(&(ptr->result), vamp_args->result);
+	for (size_t i = 0; i < COUNT_ARRAY_SIZE; i++)
+		ptr->count[i] += vamp_args->local_count[i];
 
 	vamp_args->result = NULL;
+	ptr->runtime += runtime;
+
+	if (atomic_fetch_sub(&(ptr->pieces), 1) != 1)
+		return false;
+
+	ptr->bytes = array_bytes(ptr->result);
+	if (!MULTIPLIER_TASKS)
+		array_finish(&(ptr->result), &(ptr->count));
+	return true;
+}
+
+// Splits off the upper half of a piece, or of its multipliers with MULTIPLIER_TASKS.
+void task_split(struct piece *ptr, struct piece *upper)
+{
+	atomic_fetch_add(&(ptr->task->pieces), 1);
+
+	if (MULTIPLIER_TASKS) {
+		OPTIONAL_ASSERT(ptr->fmin < ptr->fmax);
+		fang_t middle = ptr->fmin + (ptr->fmax - ptr->fmin) / 2;
+		*upper = *ptr;
+		upper->fmin = middle + 1;
+		ptr->fmax = middle;
+		return;
+	}
+
+	OPTIONAL_ASSERT(ptr->lmin < ptr->lmax);
+	vamp_t middle = ptr->lmin + (ptr->lmax - ptr->lmin) / 2;
+	*upper = *ptr;
+	upper->lmin = middle + 1;
+	ptr->lmax = middle;
+}
+
+// Splits off the multipliers [fmin, fmax] at the bottom of a running piece.
+void task_split_multipliers(struct piece *ptr, fang_t fmin, fang_t fmax, struct piece *lower)
+{
+	OPTIONAL_ASSERT(fmin <= fmax);
+
+	atomic_fetch_add(&(ptr->task->pieces), 1);
+
+	*lower = *ptr;
+	lower->fmin = fmin;
+	lower->fmax = fmax;
+	ptr->fmin = fmax + 1;
+}
+
+void task_add_finished(struct task *ptr, const struct piece *piece)
+{
+	if (piece->lmin > piece->lmax || piece->fmin > piece->fmax)
+		return;
+
+	if (ptr->finished_count == ptr->finished_capacity) {
+		ptr->finished_capacity = 2 * ptr->finished_capacity + 4;
+		ptr->finished = realloc(ptr->finished, sizeof(struct piece) * ptr->finished_capacity);
+		if (ptr->finished == NULL)
+			abort();
+	}
+	ptr->finished[ptr->finished_count] = *piece;
+	ptr->finished[ptr->finished_count].task = ptr;
+	ptr->finished_count += 1;
+}
+
+static void pieces_add(struct piece **pieces, size_t *size, size_t *capacity, struct piece piece)
+{
+	if (*size == *capacity) {
+		*capacity = 2 * (*capacity) + 4;
+		*pieces = realloc(*pieces, sizeof(struct piece) * (*capacity));
+		if (*pieces == NULL)
+			abort();
+	}
+	(*pieces)[(*size)++] = piece;
+}
+
+/*
+ * task_remaining:
+ *
+ * 	Cuts the finished pieces out of the task, and returns what's left in
+ * *pieces, which the caller frees. Every finished piece can cut a piece in
+ * up to four: the numbers below and above it, and the multipliers below and
+ * above it for the numbers it shares.
+ */
+
+size_t task_remaining(struct task *ptr, struct piece **pieces)
+{
+	struct piece *list = NULL;
+	size_t size = 0;
+	size_t capacity = 0;
+	pieces_add(&list, &size, &capacity, (struct piece){ptr, ptr->lmin, ptr->lmax, ptr->fmin, ptr->fmax});
+
+	for (size_t i = 0; i < ptr->finished_count; i++) {
+		struct piece *cut = &(ptr->finished[i]);
+		struct piece *next = NULL;
+		size_t next_size = 0;
+		size_t next_capacity = 0;
+
+		for (size_t j = 0; j < size; j++) {
+			struct piece p = list[j];
+			if (cut->lmax < p.lmin || cut->lmin > p.lmax || cut->fmax < p.fmin || cut->fmin > p.fmax) {
+				pieces_add(&next, &next_size, &next_capacity, p);
+				continue;
+			}
+			struct piece tmp = p;
+			if (cut->lmin > p.lmin) {
+				tmp.lmax = cut->lmin - 1;
+				pieces_add(&next, &next_size, &next_capacity, tmp);
+				p.lmin = cut->lmin;
+			}
+			if (cut->lmax < p.lmax) {
+				tmp = p;
+				tmp.lmin = cut->lmax + 1;
+				pieces_add(&next, &next_size, &next_capacity, tmp);
+				p.lmax = cut->lmax;
+			}
+			if (cut->fmin > p.fmin) {
+				tmp = p;
+				tmp.fmax = cut->fmin - 1;
+				pieces_add(&next, &next_size, &next_capacity, tmp);
+			}
+			if (cut->fmax < p.fmax) {
+				tmp = p;
+				tmp.fmin = cut->fmax + 1;
+				pieces_add(&next, &next_size, &next_capacity, tmp);
+			}
+		}
+		free(list);
+		list = next;
+		size = next_size;
+		capacity = next_capacity;
+	}
+	*pieces = list;
+	return size;
+}
+
+// Moves the results and the finished pieces of a saved task into a new one.
+void task_restore(struct task *ptr, struct task *saved)
+{
+	OPTIONAL_ASSERT(ptr->result == NULL);
+	OPTIONAL_ASSERT(ptr->finished_count == 0);
+
+	ptr->result = saved->result;
+	saved->result = NULL;
+	memcpy(ptr->count, saved->count, sizeof(ptr->count));
+	ptr->runtime = saved->runtime;
+	for (size_t i = 0; i < saved->finished_count; i++)
+		task_add_finished(ptr, &(saved->finished[i]));
 }
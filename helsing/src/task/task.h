@@ -7,6 +7,7 @@
 #define HELSING_TASK_H
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include "configuration_adv.h"
 #include "vargs.h"
 #include "array.h"
@@ -14,20 +15,60 @@
 /*
  * task:
  *
- * A task consists of a closed interval [lmin, lmax] and a pointer to an array,
- * where the results will be stored.
+ * A task consists of a closed interval [lmin, lmax], the multipliers
+ * [fmin, fmax] to check it with, its position on the taskboard and a pointer
+ * to an array, where the results will be stored.
+ * Tasks live in the slots of the taskboard's ring, see taskboard.h.
+ * Threads may split a task into pieces, the task is complete once all of
+ * them have been copied back. With TASK_CHECKPOINT, the pieces that have been
+ * copied back are kept in finished, so that the task can be saved half way.
  */
 
+struct piece;
+
 struct task
 {
+	size_t index;
+	size_t cells; // Cells of the taskboard the task covers, see MEMORY_CELLS
 	vamp_t lmin; // local minimum
 	vamp_t lmax; // local maximum
+	fang_t fmin; // 0 unless MULTIPLIER_TASKS
+	fang_t fmax; // The fmax of the digit length, unless MULTIPLIER_TASKS
 	struct array *result;
 	vamp_t count[COUNT_ARRAY_SIZE];
-	bool complete;
+	atomic_size_t pieces; // Pieces that haven't been copied back yet.
+	double runtime; // Seconds spent on all the pieces
+	size_t bytes; // Memory held by the result before array_finish, then while it waits for the writer
+	long spill; // Offset of the result in the spill file, -1 if it's in memory
+	struct piece *finished; // See TASK_CHECKPOINT
+	size_t finished_count;
+	size_t finished_capacity;
+	atomic_bool ready; // Set up by the thread that claimed it, see save_tasks
+	atomic_bool complete; // Ready for the writer, see taskboard_complete
+};
+
+/*
+ * piece:
+ *
+ * A part [lmin, lmax] of a task, the unit of work that threads process and
+ * steal from each other. Only the multipliers in [fmin, fmax] are checked.
+ */
+
+struct piece
+{
+	struct task *task;
+	vamp_t lmin;
+	vamp_t lmax;
+	fang_t fmin;
+	fang_t fmax;
 };
 
-void task_new(struct task **ptr, vamp_t lmin, vamp_t lmax);
-void task_free(struct task *ptr);
-void task_copy_vargs(struct task *ptr, struct vargs *vamp_args);
+void task_init(struct task *ptr, size_t index, vamp_t lmin, vamp_t lmax, fang_t fmin, fang_t fmax);
+void task_clear(struct task *ptr);
+bool task_copy_vargs(struct task *ptr, struct vargs *vamp_args, double runtime, const struct piece *piece);
+void task_add_finished(struct task *ptr, const struct piece *piece);
+size_t task_remaining(struct task *ptr, struct piece **pieces);
+void task_restore(struct task *ptr, struct task *saved);
+void task_split(struct piece *ptr, struct piece *upper);
+void task_split_multipliers(struct piece *ptr, fang_t fmin, fang_t fmax, struct piece *lower);
 #endif /* HELSING_TASK_H */
@@ -10,15 +10,20 @@
 #include <stdbool.h>
 #include <string.h>
 #include <threads.h>
+#include <stdatomic.h>
+#include <time.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
 #include "helper.h"
 #include "array.h"
 #include "task.h"
+#include "deque.h"
+#include "costmodel.h"
 #include "taskboard.h"
 #include "checkpoint.h"
 #include "hash.h"
+#include "binary.h"
 
 void taskboard_new(struct taskboard **ptr, struct options_t options)
 {
@@ -30,29 +35,127 @@ void taskboard_new(struct taskboard **ptr, struct options_t options)
 		abort();
 
 	new->options = options;
-	new->tasks = NULL;
+	new->cells = 1;
+	new->task_bytes = 0;
+	new->window_bytes = options.window_bytes;
+	if (options.max_memory != 0) {
+		// Half for the held results, half for the running tasks and their lists.
+		new->cells = MEMORY_CELLS;
+		new->task_bytes = options.max_memory / 4 / options.threads;
+		if (new->window_bytes == 0 || new->window_bytes > options.max_memory / 2)
+			new->window_bytes = options.max_memory / 2;
+	}
+	new->ring = TASKBOARD_WINDOW * options.threads * new->cells;
+	if (options.window_tasks != 0)
+		new->ring = options.window_tasks; // Cells come out of it, see taskboard_cells
+	new->tasks = malloc(sizeof(struct task) * new->ring);
+	if (new->tasks == NULL)
+		abort();
+
+	for (size_t i = 0; i < new->ring; i++) {
+		new->tasks[i].result = NULL;
+		new->tasks[i].finished = NULL;
+		task_clear(&(new->tasks[i]));
+	}
 	new->size = 0;
-	new->todo = 0;
-	new->fmax = 0;
-	new->done = 0;
+	atomic_init(&(new->todo), 0);
+	atomic_init(&(new->done), 0);
+	atomic_init(&(new->window_end), new->ring);
+	mtx_init(&(new->window_mtx), mtx_plain);
+	cnd_init(&(new->window_moved));
+	cnd_init(&(new->head_complete));
+	atomic_init(&(new->held_bytes), 0);
+	new->spill = NULL;
+	mtx_init(&(new->spill_mtx), mtx_plain);
+	new->spill_end = 0;
+	new->spilled = 0;
+	new->spans = NULL;
+	new->span_count = 0;
+	new->current = 0;
+	new->complete = 0;
+	new->saved = 0;
+	new->unsaved = 0;
+	new->saved_time = 0;
+	new->head = NULL;
+	new->head_size = 0;
+	new->tail = NULL;
+	new->tail_size = 0;
 	memset(new->common_count, 0, sizeof(new->common_count));
 	memset(new->common_prev, 0, sizeof(new->common_prev));
 	new->checksum = NULL;
 	hash_new(&(new->checksum));
+
+	new->cost = NULL;
+	costmodel_new(&(new->cost), options.profile);
+
+	new->deques = NULL;
+	if (WORK_STEALING) {
+		new->deques = malloc(sizeof(struct deque *) * options.threads);
+		if (new->deques == NULL)
+			abort();
+
+		for (thread_t thread = 0; thread < options.threads; thread++) {
+			new->deques[thread] = NULL;
+			deque_new(&(new->deques[thread]));
+		}
+	}
+
+	new->runners = malloc(sizeof(struct runner) * options.threads);
+	if (new->runners == NULL)
+		abort();
+
+	for (thread_t thread = 0; thread < options.threads; thread++)
+		multipliers_init(&(new->runners[thread].multipliers));
+
+	new->task_checkpoint = (
+		TASK_CHECKPOINT > 0 && WORK_STEALING && !MULTIPLIER_TASKS &&
+		options.checkpoint != NULL && !options.dry_run);
+	new->restored = NULL;
+	new->restored_count = 0;
+	atomic_init(&(new->stop), false);
+	new->finished = false;
 	*ptr = new;
 }
 
+static void spans_free(struct taskboard *ptr)
+{
+	for (size_t i = 0; i < ptr->span_count; i++)
+		for (size_t level = 0; level < SPAN_LEVELS; level++)
+			array_free(ptr->spans[i].results[level]);
+	free(ptr->spans);
+	ptr->spans = NULL;
+}
+
 void taskboard_free(struct taskboard *ptr)
 {
 	if (ptr == NULL)
 		return;
 
-	if (ptr->tasks != NULL) {
-		for (size_t i = 0; i < ptr->size; i++)
-			task_free(ptr->tasks[i]);
-		free(ptr->tasks);
+	for (size_t i = 0; i < ptr->ring; i++)
+		task_clear(&(ptr->tasks[i]));
+	free(ptr->tasks);
+	mtx_destroy(&(ptr->window_mtx));
+	cnd_destroy(&(ptr->window_moved));
+	cnd_destroy(&(ptr->head_complete));
+	if (ptr->spill != NULL)
+		fclose(ptr->spill);
+	mtx_destroy(&(ptr->spill_mtx));
+	spans_free(ptr);
+	if (ptr->deques != NULL) {
+		for (thread_t thread = 0; thread < ptr->options.threads; thread++)
+			deque_free(ptr->deques[thread]);
+		free(ptr->deques);
 	}
+	for (thread_t thread = 0; thread < ptr->options.threads; thread++)
+		multipliers_destroy(&(ptr->runners[thread].multipliers));
+	free(ptr->runners);
+	for (size_t i = 0; i < ptr->restored_count; i++)
+		task_clear(&(ptr->restored[i]));
+	free(ptr->restored);
+	costmodel_free(ptr->cost);
 	hash_free(ptr->checksum);
+	free(ptr->head);
+	free(ptr->tail);
 	free(ptr);
 }
 
@@ -63,42 +166,36 @@ static vamp_t get_interval_size(struct options_t options, vamp_t lmin, vamp_t lm
 
 	bimax_t interval_size = SIZE_MAX;
 	vamp_t tmp = (lmax - lmin) / (4 * options.threads + 2);
+	if (options.max_memory != 0)
+		tmp /= MEMORY_CELLS;
 	if (tmp < interval_size)
 		interval_size = tmp;
 
+	// With --max-memory this caps the cells, so the first tasks are no bigger.
 	if (interval_size > (bimax_t)MAX_TASK_SIZE)
 		interval_size = MAX_TASK_SIZE;
 
 	return interval_size;
 }
 
-static inline void taskboard_set_task(struct taskboard *ptr, size_t index)
+static vamp_t get_lmax(vamp_t lmin, vamp_t max)
 {
-	OPTIONAL_ASSERT(ptr != NULL);
-	OPTIONAL_ASSERT(index >= ptr->todo);
-
-	vamp_t l_bound = ptr->lmin + (ptr->interval_size + 1) * index;
-	vamp_t u_bound = l_bound;
-	if (VAMP_MAX() - ptr->interval_size > u_bound)
-		u_bound += ptr->interval_size ;
-	if (u_bound > ptr->lmax)
-		u_bound = ptr->lmax;
-
-	task_new(&(ptr->tasks[index]), l_bound, u_bound);
+	if (length(lmin) < length(VAMP_MAX())) {
+		vamp_t lmax = pow_v(length(lmin)) - 1;
+		if (lmax < max)
+			return lmax;
+	}
+	return max;
 }
 
-void taskboard_set(struct taskboard *ptr, vamp_t lmin, vamp_t lmax)
-{
-	assert(ptr->done == ptr->size);
-	for (size_t i = 0; i < ptr->size; i++)
-		task_free(ptr->tasks[i]);
-	free(ptr->tasks);
-	ptr->tasks = NULL;
-	ptr->size = 0;
-	ptr->todo = 0;
-	ptr->done = 0;
-	ptr->fmax = 0;
+/*
+ * span_set:
+ *
+ * Returns false if there's nothing to check in [lmin, lmax].
+ */
 
+static bool span_set(struct span *ptr, struct options_t options, vamp_t lmin, vamp_t lmax)
+{
 	assert(lmin <= lmax);
 
 	length_t fang_length = length(lmin) / 2;
@@ -120,76 +217,729 @@ void taskboard_set(struct taskboard *ptr, vamp_t lmin, vamp_t lmax)
 		vamp_t fmaxsquare = ptr->fmax;
 		fmaxsquare *= ptr->fmax;
 		if (fmaxsquare < lmin)
-			return;
+			return false;
 		else if (fmaxsquare < lmax)
 			lmax = fmaxsquare;
 	}
 
 	ptr->lmin = lmin;
 	ptr->lmax = lmax;
-	ptr->interval_size = get_interval_size(ptr->options, lmin, lmax);
+	ptr->restored = NULL;
+	ptr->fmin = sqrtv_roof(lmin);
+	if (ptr->fmin == 0)
+		ptr->fmin = 1;
+	memset(ptr->results, 0, sizeof(ptr->results));
+	memset(ptr->count, 0, sizeof(ptr->count));
+	atomic_init(&(ptr->cell_bytes), SIZE_MAX);
+	ptr->interval_size = get_interval_size(options, lmin, lmax);
+
+	ptr->size = SIZE_MAX;
+	vamp_t tmp = div_roof((lmax - lmin + 1), ptr->interval_size + (ptr->interval_size < SIZE_MAX));
+	if (tmp < ptr->size)
+		ptr->size = tmp;
+	return (ptr->size > 0);
+}
 
+// The number of saved tasks from #first on that lie in [lmin, lmax].
+static size_t restored_span(struct taskboard *ptr, size_t first, vamp_t lmin, vamp_t lmax)
+{
+	size_t ret = 0;
+	while (
+		first + ret < ptr->restored_count &&
+		ptr->restored[first + ret].lmin >= lmin &&
+		ptr->restored[first + ret].lmax <= lmax)
 	{
-		ptr->size = SIZE_MAX;
-		vamp_t tmp = div_roof((lmax - lmin + 1), ptr->interval_size + (ptr->interval_size < SIZE_MAX));
-		if (tmp < ptr->size)
-			ptr->size = tmp;
+		ret++;
 	}
+	return ret;
+}
+
+/*
+ * taskboard_set:
+ *
+ * 	Lays out the tasks of (complete, max], one span per digit length, so
+ * that threads can move on to the next length while the last tasks of the
+ * previous one are still running. The results are still processed in the
+ * order of the tasks, so the output and the checkpoint don't change.
+ *
+ * 	The saved tasks of load_checkpoint come first, they start right after
+ * complete and keep their bounds.
+ */
 
-	ptr->tasks = malloc(sizeof(struct task *) * ptr->size);
-	if (ptr->tasks == NULL)
+void taskboard_set(struct taskboard *ptr, vamp_t complete, vamp_t max)
+{
+	assert(ptr->done == ptr->size);
+	for (size_t i = 0; i < ptr->ring; i++)
+		task_clear(&(ptr->tasks[i]));
+	spans_free(ptr);
+	ptr->size = 0;
+	ptr->span_count = 0;
+	ptr->current = 0;
+	atomic_store(&(ptr->todo), 0);
+	ptr->done = 0;
+	ptr->complete = complete;
+	ptr->saved = complete;
+	ptr->unsaved = 0;
+	ptr->saved_time = time(NULL);
+	atomic_store(&(ptr->window_end), ptr->ring);
+
+	size_t lengths = ptr->restored_count;
+	for (vamp_t lmax = complete; lmax < max; lengths++)
+		lmax = get_lmax(get_min(lmax + 1, max), max);
+
+	ptr->spans = malloc(sizeof(struct span) * lengths);
+	if (ptr->spans == NULL)
 		abort();
 
-	for (size_t i = 0; i < ptr->size; i++)
-		ptr->tasks[i] = NULL;
+	size_t restored = 0;
+	vamp_t header_max = 0;
+	for (vamp_t lmin, lmax = complete; lmax < max;) {
+		lmin = get_min(lmax + 1, max);
+		lmax = get_lmax(lmin, max);
+		vamp_t length_max = lmax;
+
+		struct span *span = &(ptr->spans[ptr->span_count]);
+		size_t saved = restored_span(ptr, restored, lmin, lmax);
+		if (saved > 0) {
+			lmax = ptr->restored[restored + saved - 1].lmax;
+			span_set(span, ptr->options, ptr->restored[restored].lmin, lmax);
+			span->size = saved;
+			span->restored = &(ptr->restored[restored]);
+			restored += saved;
+		} else if (!span_set(span, ptr->options, lmin, lmax)) {
+			continue;
+		}
+
+		span->header_max = (length_max != header_max ? length_max : 0);
+		header_max = length_max;
+		span->first = ptr->size;
+		ptr->size += span->size;
+		costmodel_set(ptr->cost, &(span->cost), span->lmin, span->lmax, span->fmax, span->size, ptr->options.manual_task_size != 0);
+		timespec_get(&(span->start), TIME_UTC);
+		ptr->span_count += 1;
+	}
+}
+
+static struct span *taskboard_span(struct taskboard *ptr, size_t index)
+{
+	size_t i = 0;
+	while (index >= ptr->spans[i].first + ptr->spans[i].size)
+		i++;
+	return &(ptr->spans[i]);
+}
+
+/*
+ * span_bound:
+ *
+ * 	Returns the first number of task #index of the span. Tasks are cut to
+ * equal estimated cost, see costmodel.h, or to equal width when the task
+ * size is set manually.
+ */
+
+static vamp_t span_bound(struct span *ptr, size_t index)
+{
+	if (ptr->restored != NULL)
+		return ptr->restored[index].lmin;
+	if (index == 0)
+		return ptr->lmin;
+	if (ptr->cost.equal_width)
+		return (ptr->lmin + (ptr->interval_size + 1) * index);
+	return costmodel_cut(&(ptr->cost), index, ptr->size);
+}
+
+// Returns the first multiplier of task #index of the span, see MULTIPLIER_TASKS.
+static fang_t span_multiplier_bound(struct span *ptr, size_t index)
+{
+	if (index == 0)
+		return ptr->fmin;
+	return costmodel_multiplier_cut(&(ptr->cost), ptr->fmin, ptr->fmax, index, ptr->size);
+}
+
+// Without REORDER_SPILL, threads wait while the held results are over the limit.
+static bool taskboard_over_budget(struct taskboard *ptr)
+{
+	return (!REORDER_SPILL && ptr->window_bytes != 0 && atomic_load(&(ptr->held_bytes)) > ptr->window_bytes);
+}
+
+// The number of cells to claim at index, see MEMORY_CELLS.
+static size_t taskboard_cells(struct taskboard *ptr, struct span *span, size_t index)
+{
+	size_t ret = 1;
+	size_t cell_bytes = atomic_load(&(span->cell_bytes));
+	if (span->restored != NULL)
+		return ret;
+	if (cell_bytes == 0)
+		ret = ptr->cells;
+	else if (cell_bytes != SIZE_MAX)
+		ret = ptr->task_bytes / cell_bytes;
+
+	if (ret > ptr->cells)
+		ret = ptr->cells;
+	if (ret > span->first + span->size - index)
+		ret = span->first + span->size - index;
+	if (ret > atomic_load(&(ptr->window_end)) - index)
+		ret = atomic_load(&(ptr->window_end)) - index;
+	if (ret < 1)
+		ret = 1;
+	return ret;
+}
+
+/*
+ * taskboard_claim_task:
+ *
+ * 	Tasks are claimed with a compare-and-swap on todo, and their bounds are
+ * computed from the index, so there's no lock on this path. Returns NULL if
+ * every task has been claimed, or if the next one is past the window. The
+ * claiming thread owns the task until it's complete, see task_copy_vargs.
+ *
+ * 	A saved task that was already complete goes straight to the writer,
+ * and the next one is claimed instead.
+ */
 
-	for (size_t i = 0; i < ptr->size && i < TASKBOARD_LIMIT; i++)
-		taskboard_set_task(ptr, i);	
+static struct task *taskboard_claim_task(struct taskboard *ptr, bool *skipped)
+{
+	struct span *span;
+	size_t cells;
+	size_t index = atomic_load_explicit(&(ptr->todo), memory_order_relaxed);
+	do {
+		if (index >= ptr->size || index >= atomic_load(&(ptr->window_end)) || taskboard_over_budget(ptr))
+			return NULL;
+		if (atomic_load(&(ptr->stop)))
+			return NULL;
+		span = taskboard_span(ptr, index);
+		cells = taskboard_cells(ptr, span, index);
+	} while (!atomic_compare_exchange_weak(&(ptr->todo), &index, index + cells));
+
+	size_t local = index - span->first;
+	size_t next = local + cells;
+	if (local == 0)
+		timespec_get(&(span->start), TIME_UTC);
+
+	for (size_t i = 1; i < cells; i++) {
+		struct task *empty = &(ptr->tasks[(index + i) % ptr->ring]);
+		task_init(empty, index + i, 1, 0, 1, 0);
+		atomic_store(&(empty->ready), true);
+		taskboard_complete(ptr, empty);
+	}
+
+	struct task *ret = &(ptr->tasks[index % ptr->ring]);
+	if (MULTIPLIER_TASKS) {
+		fang_t f_bound = span->fmax;
+		if (next < span->size)
+			f_bound = span_multiplier_bound(span, next) - 1; // May leave the task empty
+		task_init(ret, index, span->lmin, span->lmax, span_multiplier_bound(span, local), f_bound);
+	} else {
+		vamp_t u_bound = span->lmax;
+		if (next < span->size)
+			u_bound = span_bound(span, next) - 1; // May leave the task empty
+		task_init(ret, index, span_bound(span, local), u_bound, 0, span->fmax);
+		if (span->restored != NULL)
+			task_restore(ret, &(span->restored[local]));
+		*skipped = (span->restored != NULL && atomic_load(&(span->restored[local].complete)));
+	}
+	ret->cells = cells;
+	atomic_store(&(ret->ready), true);
+	if (*skipped)
+		taskboard_complete(ptr, ret);
+	return ret;
 }
 
 struct task *taskboard_get_task(struct taskboard *ptr)
 {
-	if (ptr->todo >= ptr->size)
-		return NULL;
+	struct task *ret;
+	bool skipped;
+	do {
+		skipped = false;
+		ret = taskboard_claim_task(ptr, &skipped);
+	} while (skipped);
+	return ret;
+}
+
+/*
+ * taskboard_wait:
+ *
+ * Waits for the window to move past the next task, and for the held
+ * results to get under the limit. Returns false if every task has been
+ * claimed, or if the taskboard was stopped.
+ */
+
+static bool taskboard_wait(struct taskboard *ptr)
+{
+	mtx_lock(&(ptr->window_mtx));
+	while (
+		atomic_load(&(ptr->todo)) < ptr->size && !atomic_load(&(ptr->stop)) && (
+		atomic_load(&(ptr->todo)) >= atomic_load(&(ptr->window_end)) ||
+		taskboard_over_budget(ptr)))
+	{
+		cnd_wait(&(ptr->window_moved), &(ptr->window_mtx));
+	}
+	bool ret = (atomic_load(&(ptr->todo)) < ptr->size && !atomic_load(&(ptr->stop)));
+	mtx_unlock(&(ptr->window_mtx));
+	return ret;
+}
 
-	size_t todo = ptr->todo;
+/*
+ * taskboard_resume:
+ *
+ * 	Leaves only the pieces of a saved task that weren't finished. The
+ * thread takes the first one, and the rest go to its deque.
+ */
 
-	if (ptr->tasks[ptr->todo] == NULL) {
-		size_t interval = ptr->size - ptr->todo;
-		if (interval > TASKBOARD_LIMIT)
-			interval = TASKBOARD_LIMIT;
+static void taskboard_resume(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	struct piece *pieces = NULL;
+	size_t count = task_remaining(piece->task, &pieces);
+	if (count == 0) {
+		// Nothing left, the empty piece only completes the task.
+		piece->fmin = 1;
+		piece->fmax = 0;
+	} else {
+		*piece = pieces[0];
+		atomic_fetch_add(&(piece->task->pieces), count - 1);
+		for (size_t i = 1; i < count; i++)
+			deque_push(ptr->deques[thread], pieces[i]);
+	}
+	free(pieces);
+}
 
-		for (size_t i = 0; i < interval; i++) {
-			taskboard_set_task(ptr, i + ptr->todo);
-		}
+static bool taskboard_claim_piece(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	piece->task = taskboard_get_task(ptr);
+	if (piece->task == NULL)
+		return false;
+
+	piece->lmin = piece->task->lmin;
+	piece->lmax = piece->task->lmax;
+	piece->fmin = piece->task->fmin;
+	piece->fmax = piece->task->fmax;
+	if (piece->task->finished_count > 0)
+		taskboard_resume(ptr, thread, piece);
+	return true;
+}
+
+// Takes the bottom half of the multipliers that another thread hasn't reached.
+static bool taskboard_split_runner(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	struct runner *runner = &(ptr->runners[thread]);
+	fang_t fmin, fmax;
+
+	mtx_lock(&(runner->multipliers.mtx));
+	bool ret = multipliers_split(&(runner->multipliers), &fmin, &fmax);
+	if (ret)
+		task_split_multipliers(&(runner->piece), fmin, fmax, piece);
+	mtx_unlock(&(runner->multipliers.mtx));
+	return ret;
+}
+
+/*
+ * taskboard_get_piece:
+ *
+ * 	A thread works on the pieces of its own deque first, then claims a new
+ * task, then steals from the top of the other deques, and finally splits the
+ * multipliers of the pieces that other threads are running.
+ *
+ * 	Once every task has been claimed, idle threads can only steal. From then
+ * on a thread splits off the upper half of each piece before processing it,
+ * and leaves it at the bottom of its deque for the others, down to
+ * 1/2^STEAL_DEPTH of the task. Splitting any earlier, or with a single thread, would only
+ * repeat the setup of vampire() for nothing.
+ */
+
+static bool taskboard_find_piece(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	if (!WORK_STEALING)
+		return taskboard_claim_piece(ptr, thread, piece);
+	if (ptr->task_checkpoint && atomic_load(&(ptr->stop)))
+		return false; // The rest gets saved, see taskboard_stop
+
+	bool found = deque_pop(ptr->deques[thread], piece);
+	if (!found)
+		found = taskboard_claim_piece(ptr, thread, piece);
+	for (thread_t i = 1; !found && i < ptr->options.threads; i++)
+		found = deque_steal(ptr->deques[(thread + i) % ptr->options.threads], piece);
+	for (thread_t i = 1; SPLIT_MULTIPLIERS && !found && i < ptr->options.threads; i++)
+		found = taskboard_split_runner(ptr, (thread + i) % ptr->options.threads, piece);
+	return found;
+}
+
+// Whether a piece is still bigger than 1/2^STEAL_DEPTH of its task.
+static bool piece_splittable(struct piece *piece)
+{
+	if (MULTIPLIER_TASKS) {
+		fang_t size = (piece->task->fmax - piece->task->fmin) >> STEAL_DEPTH;
+		return (piece->fmin < piece->fmax && piece->fmax - piece->fmin > size);
+	}
+	vamp_t size = (piece->task->lmax - piece->task->lmin) >> STEAL_DEPTH;
+	return (piece->lmin < piece->lmax && piece->lmax - piece->lmin > size);
+}
+
+// Lets the other threads split the multipliers of the piece.
+static void taskboard_run(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	mtx_lock(&(ptr->runners[thread].multipliers.mtx));
+	ptr->runners[thread].piece = *piece;
+	mtx_unlock(&(ptr->runners[thread].multipliers.mtx));
+}
+
+bool taskboard_get_piece(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	while (!taskboard_find_piece(ptr, thread, piece))
+		if (!taskboard_wait(ptr))
+			return false;
+
+	bool tail = (ptr->options.threads > 1 && atomic_load(&(ptr->todo)) >= ptr->size);
+	if (WORK_STEALING && tail && piece_splittable(piece)) {
+		struct piece upper;
+		task_split(piece, &upper);
+		deque_push(ptr->deques[thread], upper);
+	}
+
+	taskboard_run(ptr, thread, piece);
+	return true;
+}
+
+/*
+ * taskboard_get_own_piece:
+ *
+ * 	Only takes the pieces that are left in the thread's own deque, for a
+ * worker that's retiring, see struct pool.
+ */
+
+bool taskboard_get_own_piece(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	if (ptr->task_checkpoint && atomic_load(&(ptr->stop)))
+		return false;
+	if (!WORK_STEALING || !deque_pop(ptr->deques[thread], piece))
+		return false;
+
+	taskboard_run(ptr, thread, piece);
+	return true;
+}
+
+/*
+ * taskboard_finish_piece:
+ *
+ * 	Returns the part of the thread's piece that vampire() went through,
+ * after the other threads took their share of its multipliers. If vampire()
+ * stopped early for the task checkpoint, the multipliers it didn't reach go
+ * back to the thread's deque as a new piece.
+ */
+
+void taskboard_finish_piece(struct taskboard *ptr, thread_t thread, struct piece *piece)
+{
+	struct runner *runner = &(ptr->runners[thread]);
+	struct piece rest;
+	fang_t fmax;
+
+	mtx_lock(&(runner->multipliers.mtx));
+	*piece = runner->piece;
+	bool yielded = multipliers_yielded(&(runner->multipliers), &fmax);
+	if (yielded)
+		task_split_multipliers(piece, piece->fmin, fmax, &rest);
+	mtx_unlock(&(runner->multipliers.mtx));
+
+	if (yielded)
+		deque_push(ptr->deques[thread], rest);
+}
+
+/*
+ * taskboard_stop:
+ *
+ * 	Stops handing out tasks. The tasks that have been claimed are finished,
+ * unless there's a task checkpoint to save them in: then every vampire()
+ * call stops at its next block of multipliers, and the pieces that are left
+ * stay in the deques for save_tasks.
+ */
+
+void taskboard_stop(struct taskboard *ptr)
+{
+	atomic_store(&(ptr->stop), true);
+	for (thread_t thread = 0; ptr->task_checkpoint && thread < ptr->options.threads; thread++) {
+		mtx_lock(&(ptr->runners[thread].multipliers.mtx));
+		ptr->runners[thread].multipliers.stop = true;
+		mtx_unlock(&(ptr->runners[thread].multipliers.mtx));
+	}
+	mtx_lock(&(ptr->window_mtx));
+	cnd_broadcast(&(ptr->window_moved));
+	mtx_unlock(&(ptr->window_mtx));
+}
+
+/*
+ * taskboard_yield:
+ *
+ * 	Makes every running vampire() call stop at its next block of
+ * multipliers, so that the pieces it finished are in their tasks when the
+ * tasks are saved. The rest of the piece goes back to the deque.
+ */
+
+void taskboard_yield(struct taskboard *ptr)
+{
+	for (thread_t thread = 0; thread < ptr->options.threads; thread++)
+		atomic_store(&(ptr->runners[thread].multipliers.yield), true);
+}
+
+/*
+ * taskboard_finish:
+ *
+ * Lets the writer go once the workers are done, even if some tasks were
+ * never completed because of taskboard_stop.
+ */
+
+void taskboard_finish(struct taskboard *ptr)
+{
+	mtx_lock(&(ptr->window_mtx));
+	ptr->finished = true;
+	cnd_broadcast(&(ptr->head_complete));
+	mtx_unlock(&(ptr->window_mtx));
+}
+
+/*
+ * taskboard_spill:
+ *
+ * 	Moves the result of a complete task to the end of the spill file. The
+ * file is reused from the start once every result in it has been read back.
+ * Returns false if the result has to stay in memory.
+ */
+
+static bool taskboard_spill(struct taskboard *ptr, struct task *task)
+{
+	if (task->result == NULL)
+		return false;
+
+	bool ret = false;
+	mtx_lock(&(ptr->spill_mtx));
+	if (ptr->spill == NULL)
+		ptr->spill = tmpfile();
+	if (ptr->spill == NULL)
+		goto out;
+
+	if (fseek(ptr->spill, ptr->spill_end, SEEK_SET) != 0)
+		goto out;
+	if (array_save(task->result, ptr->spill) != 0)
+		goto out;
+
+	task->spill = ptr->spill_end;
+	ptr->spill_end = ftell(ptr->spill);
+	ptr->spilled += 1;
+	array_free(task->result);
+	task->result = NULL;
+	ret = true;
+out:
+	mtx_unlock(&(ptr->spill_mtx));
+	return ret;
+}
+
+// Reads a spilled result back, only for the writer.
+static void taskboard_unspill(struct taskboard *ptr, struct task *task)
+{
+	mtx_lock(&(ptr->spill_mtx));
+	if (fseek(ptr->spill, task->spill, SEEK_SET) != 0 || array_load(&(task->result), ptr->spill)) {
+		fprintf(stderr, "Can't read back spilled results\n");
+		abort();
+	}
+	ptr->spilled -= 1;
+	if (ptr->spilled == 0)
+		ptr->spill_end = 0;
+	mtx_unlock(&(ptr->spill_mtx));
+	task->spill = -1;
+}
+
+/*
+ * span_observe:
+ *
+ * 	Updates the result memory per cell of the span with a complete task.
+ * It follows a rise at once, but falls only by a quarter at a time, so that
+ * one sparse task doesn't make the next ones too big.
+ */
+
+static void span_observe(struct span *ptr, size_t bytes)
+{
+	size_t old = atomic_load(&(ptr->cell_bytes));
+	size_t new;
+	do {
+		new = bytes;
+		if (old != SIZE_MAX && bytes < old)
+			new = old - (old - bytes) / 4;
+	} while (!atomic_compare_exchange_weak(&(ptr->cell_bytes), &old, new));
+}
+
+/*
+ * taskboard_complete:
+ *
+ * 	Hands a complete task over to the writer. Only the task the writer is
+ * waiting for needs a wake-up call, for the rest the writer will find the
+ * flag on its own.
+ */
+
+void taskboard_complete(struct taskboard *ptr, struct task *task)
+{
+	if (ptr->cells > 1 && task->lmin <= task->lmax)
+		span_observe(taskboard_span(ptr, task->index), task->bytes / task->cells);
+	task->bytes = array_bytes(task->result);
+	if (
+		REORDER_SPILL &&
+		ptr->window_bytes != 0 &&
+		task->index != atomic_load(&(ptr->done)) &&
+		atomic_load(&(ptr->held_bytes)) + task->bytes > ptr->window_bytes &&
+		taskboard_spill(ptr, task))
+	{
+		task->bytes = 0;
+	}
+	atomic_fetch_add(&(ptr->held_bytes), task->bytes);
+	atomic_store(&(task->complete), true);
+	if (task->index == atomic_load(&(ptr->done))) {
+		mtx_lock(&(ptr->window_mtx));
+		cnd_signal(&(ptr->head_complete));
+		mtx_unlock(&(ptr->window_mtx));
+	}
+}
 
+/*
+ * taskboard_wait_complete:
+ *
+ * Waits until task #done is complete, or until the deadline if it isn't
+ * NULL. Returns false once every task has been processed, or once the
+ * workers are done, see taskboard_finish. Only for the writer.
+ */
+
+bool taskboard_wait_complete(struct taskboard *ptr, const struct timespec *deadline)
+{
+	mtx_lock(&(ptr->window_mtx));
+	while (ptr->done < ptr->size && !ptr->finished && !atomic_load(&(ptr->tasks[ptr->done % ptr->ring].complete))) {
+		if (deadline == NULL)
+			cnd_wait(&(ptr->head_complete), &(ptr->window_mtx));
+		else if (cnd_timedwait(&(ptr->head_complete), &(ptr->window_mtx), deadline) == thrd_timedout)
+			break;
 	}
-	struct task *ret = ptr->tasks[todo];
-	ptr->todo += 1;
+	bool ret = (ptr->done < ptr->size && !ptr->finished);
+	mtx_unlock(&(ptr->window_mtx));
 	return ret;
 }
 
+// Prints, hashes and counts the results of a task or span [lmin, lmax].
+static void taskboard_results(struct taskboard *ptr, struct array *result, vamp_t lmin, vamp_t lmax, vamp_t count[COUNT_ARRAY_SIZE], mtx_t *stdout_mtx)
+{
+	if (ptr->options.format == format_binary && lmin <= lmax)
+		binary_block(stdout, result, lmin, lmax, stdout_mtx, ptr->common_count, &(ptr->common_prev));
+	if (result != NULL) {
+		if (ptr->options.format == format_text)
+			array_print(result, stdout_mtx, ptr->common_count, &(ptr->common_prev));
+		array_checksum(result, ptr->checksum);
+	}
+	for (size_t i = 0; i < COUNT_ARRAY_SIZE; i++)
+		ptr->common_count[i] += count[i];
+}
+
+// Adds the results of a task to the levels of its span, like a binary counter.
+static void span_gather(struct span *ptr, struct task *task)
+{
+	struct array *result = task->result;
+	task->result = NULL;
+	for (size_t i = 0; i < COUNT_ARRAY_SIZE; i++)
+		ptr->count[i] += task->count[i];
+
+	for (size_t level = 0; result != NULL; level++) {
+		if (level + 1 == SPAN_LEVELS || ptr->results[level] == NULL) {
+			array_merge(&(ptr->results[level]), result);
+			break;
+		}
+		array_merge(&result, ptr->results[level]);
+		ptr->results[level] = NULL;
+	}
+}
+
+// Merges the levels of a complete span, and processes the results.
+static void span_finish(struct taskboard *ptr, struct span *span, mtx_t *stdout_mtx)
+{
+	struct array *result = NULL;
+	for (size_t level = 0; level < SPAN_LEVELS; level++) {
+		array_merge(&result, span->results[level]);
+		span->results[level] = NULL;
+	}
+	array_finish(&result, &(span->count));
+	taskboard_results(ptr, result, span->lmin, span->lmax, span->count, stdout_mtx);
+	array_free(result);
+	ptr->complete = span->lmax;
+}
+
+// taskboard_cleanup is only for the writer
 void taskboard_cleanup(struct taskboard *ptr, mtx_t *stdout_mtx)
 {
+	size_t done = ptr->done;
 	while (
 		ptr->done < ptr->size &&
-		ptr->tasks[ptr->done] != NULL &&
-		ptr->tasks[ptr->done]->complete != false)
+		ptr->tasks[ptr->done % ptr->ring].complete != false)
 	{
-		if (ptr->tasks[ptr->done]->result != NULL) {
-			array_print(ptr->tasks[ptr->done]->result, stdout_mtx, ptr->common_count, &(ptr->common_prev));
-			array_checksum(ptr->tasks[ptr->done]->result, ptr->checksum);
+		struct task *task = &(ptr->tasks[ptr->done % ptr->ring]);
+		struct span *span = &(ptr->spans[ptr->current]);
+		if (task->spill >= 0)
+			taskboard_unspill(ptr, task);
+		if (ptr->done == span->first && span->header_max != 0) {
+			mtx_lock(stdout_mtx);
+			helsing_fprint(stderr, "svsvs",  "Checking interval: [", span->lmin, ", ", span->header_max, "]\n");
+			mtx_unlock(stdout_mtx);
+		}
+		if (MULTIPLIER_TASKS)
+			span_gather(span, task);
+		else
+			taskboard_results(ptr, task->result, task->lmin, task->lmax, task->count, stdout_mtx);
+		if (task->lmin <= task->lmax) {
+			taskboard_progress(ptr, stdout_mtx);
+			if (!MULTIPLIER_TASKS && !ptr->options.dry_run)
+				costmodel_record(&(span->cost), task->lmin, task->lmax, task->runtime);
+			if (!MULTIPLIER_TASKS)
+				ptr->complete = task->lmax;
+			ptr->unsaved += 1;
 		}
-		for (size_t i = 0; i < COUNT_ARRAY_SIZE; i++)
-			ptr->common_count[i] += ptr->tasks[ptr->done]->count[i];
-		taskboard_progress(ptr, stdout_mtx);
-		if (!ptr->options.dry_run)
-			save_checkpoint(ptr->options, ptr->tasks[ptr->done]->lmax, ptr);
 
-		task_free(ptr->tasks[ptr->done]);
-		ptr->tasks[ptr->done] = NULL;
+		atomic_fetch_sub(&(ptr->held_bytes), task->bytes);
+		task_clear(task);
 		ptr->done += 1;
+		if (ptr->done == span->first + span->size) {
+			if (MULTIPLIER_TASKS)
+				span_finish(ptr, span, stdout_mtx);
+			if (!ptr->options.dry_run)
+				costmodel_learn(&(span->cost));
+			ptr->current += 1;
+			taskboard_checkpoint(ptr, CHECKPOINT_HISTORY); // The end of a digit length
+		}
 	}
+	if (ptr->done != done) {
+		atomic_store(&(ptr->window_end), ptr->done + ptr->ring);
+		mtx_lock(&(ptr->window_mtx));
+		cnd_broadcast(&(ptr->window_moved));
+		mtx_unlock(&(ptr->window_mtx));
+	}
+	taskboard_checkpoint(ptr, ptr->done == ptr->size);
+}
+
+/*
+ * taskboard_checkpoint:
+ *
+ * 	Saves the checkpoint if it's behind and CHECKPOINT_TASKS or
+ * CHECKPOINT_SECONDS say it's time, or if force is true. Only for the writer.
+ */
+
+void taskboard_checkpoint(struct taskboard *ptr, bool force)
+{
+	if (ptr->options.dry_run || ptr->saved == ptr->complete)
+		return;
+
+	time_t now = time(NULL);
+	bool due = (CHECKPOINT_TASKS == 0 && CHECKPOINT_SECONDS == 0);
+#if CHECKPOINT_TASKS > 0
+	due = due || (ptr->unsaved >= CHECKPOINT_TASKS);
+#endif
+#if CHECKPOINT_SECONDS > 0
+	due = due || (now - ptr->saved_time >= CHECKPOINT_SECONDS);
+#endif
+	if (!due && !force)
+		return;
+
+	save_checkpoint(ptr->options, ptr->complete, ptr);
+	ptr->saved = ptr->complete;
+	ptr->unsaved = 0;
+	ptr->saved_time = now;
 }
 
 void taskboard_print_results(struct taskboard *ptr)
@@ -216,14 +966,33 @@ void taskboard_print_results(struct taskboard *ptr)
 	hash_print(ptr->checksum);
 }
 
-// taskboard_progress requires mutex lock
+// taskboard_progress is only for the writer
 void taskboard_progress(struct taskboard *ptr, mtx_t *stdout_mtx)
 {
 	if (ptr->options.display_progress) {
+		struct span *span = &(ptr->spans[ptr->current]);
+		struct task *task = &(ptr->tasks[ptr->done % ptr->ring]);
+		size_t local = ptr->done - span->first + task->cells;
 		mtx_lock(stdout_mtx);
-		helsing_fprint(stderr, "vsv", ptr->tasks[ptr->done]->lmin, ", ", ptr->tasks[ptr->done]->lmax);
-
-		fprintf(stderr, "  %zu/%zu\n", ptr->done + 1, ptr->size);
+		if (MULTIPLIER_TASKS)
+			helsing_fprint(stderr, "sfsf", "multipliers ", task->fmin, ", ", task->fmax);
+		else
+			helsing_fprint(stderr, "vsv", task->lmin, ", ", task->lmax);
+
+		fprintf(stderr, "  %zu/%zu", local, span->size);
+
+		struct timespec now;
+		timespec_get(&now, TIME_UTC);
+		double elapsed = (now.tv_sec - span->start.tv_sec) + (now.tv_nsec - span->start.tv_nsec) / 1000000000.0;
+		double progress = (double)local / span->size; // The tasks are of equal cost
+		if (!MULTIPLIER_TASKS)
+			progress = costmodel_progress(&(span->cost), task->lmax);
+		fprintf(stderr, "  %.1f%%", 100.0 * progress);
+		if (progress > 0.0 && progress < 1.0) {
+			unsigned long long eta = elapsed * (1.0 - progress) / progress;
+			fprintf(stderr, "  ETA %llu:%02llu:%02llu", eta / 3600, (eta / 60) % 60, eta % 60);
+		}
+		fprintf(stderr, "\n");
 		mtx_unlock(stdout_mtx);
 	}
 }
@@ -7,24 +7,119 @@
 #define HELSING_TASKBOARD_H
 
 #include <threads.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <stdio.h>
+#include <limits.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
 #include "task.h"
+#include "deque.h"
+#include "costmodel.h"
 #include "options.h"
 #include "hash.h"
+#include "array.h"
 
-struct taskboard
+/*
+ * span:
+ *
+ * 	The tasks of one digit length [lmin, lmax]. Spans follow each other on
+ * the taskboard, task #first + i is the i-th task of the span.
+ *
+ * 	With MULTIPLIER_TASKS the results of the tasks are gathered in results,
+ * where level i holds about 2^i of them, so that every result is merged
+ * only about log2(size) times.
+ *
+ * 	The tasks that were saved half way by the task checkpoint get spans of
+ * their own, which keep their bounds, see TASK_CHECKPOINT.
+ */
+
+#define SPAN_LEVELS (sizeof(size_t) * CHAR_BIT)
+
+struct span
 {
-	struct options_t options;
-	struct task **tasks;
-	size_t size; // The size of the tasks array
-	size_t todo; // First task that hasn't been accepted.
-	size_t done; // Last task that's completed, but isn't yet processed. (print, hash, checksum...)
-	vamp_t lmin; // Copy of the lmin value
-	vamp_t lmax; // Copy of the lmax value
+	vamp_t lmin;
+	vamp_t lmax;
+	vamp_t header_max; // The end of the digit length for the header, 0 if a span before already showed it
+	fang_t fmin; // Smallest multiplier of the digit length
 	fang_t fmax;
 	vamp_t interval_size;
+	size_t first; // Index of the first task of the span
+	size_t size; // Number of tasks in the span
+	struct cost_estimate cost;
+	struct timespec start; // When the first task was claimed
+	atomic_size_t cell_bytes; // Result memory per cell, SIZE_MAX until one is known
+	struct array *results[SPAN_LEVELS]; // See MULTIPLIER_TASKS
+	vamp_t count[COUNT_ARRAY_SIZE];
+	struct task *restored; // The saved tasks of the span, or NULL
+};
+
+/*
+ * runner:
+ *
+ * The piece a thread is working on, and the multipliers it hasn't reached.
+ */
+
+struct runner
+{
+	struct piece piece;
+	struct multipliers multipliers;
+};
+
+/*
+ * taskboard:
+ *
+ * 	Task #index lives in slot index % ring of the tasks array, from the
+ * moment it's claimed until it's processed. With --max-memory, the indexes
+ * are of cells and a task can take several of them; the slots of the cells
+ * after the first are left empty. Only tasks below window_end
+ * (done + ring) can be claimed, so the ring never runs over a slot that's
+ * still in use.
+ *
+ * 	Results are processed by a single writer thread, which is the only one
+ * that touches done and everything after it in struct taskboard.
+ */
+
+struct taskboard
+{
+	struct options_t options;
+	struct task *tasks; // The ring of slots
+	size_t ring; // The number of slots
+	size_t size; // The number of tasks
+	atomic_size_t todo; // First task that hasn't been accepted.
+	atomic_size_t done; // Last task that's completed, but isn't yet processed. (print, hash, checksum...)
+	atomic_size_t window_end; // First task that can't be claimed yet
+	mtx_t window_mtx;
+	cnd_t window_moved;
+	cnd_t head_complete; // Task #done is complete, see taskboard_complete
+	size_t window_bytes; // Limit of held_bytes, 0 for none
+	size_t cells; // Cells per task of the usual size, see MEMORY_CELLS
+	size_t task_bytes; // Result memory a running task may take
+	atomic_size_t held_bytes; // Memory of the complete results that wait for the writer
+	FILE *spill; // See REORDER_SPILL
+	mtx_t spill_mtx;
+	long spill_end;
+	size_t spilled; // Results in the spill file
+	struct span *spans;
+	size_t span_count;
+	size_t current; // The span of task #done
+	struct deque **deques; // One per thread, see WORK_STEALING
+	struct runner *runners; // One per thread, see SPLIT_MULTIPLIERS
+	bool task_checkpoint; // See TASK_CHECKPOINT
+	atomic_bool stop; // No more tasks are handed out, see taskboard_stop
+	bool finished; // The workers are done, see taskboard_finish
+	struct task *restored; // The saved tasks, see load_checkpoint
+	size_t restored_count;
+	struct costmodel *cost;
+	vamp_t complete; // Everything up to here is done
+	vamp_t saved; // Everything up to here is in the checkpoint
+	size_t unsaved; // Tasks processed since the checkpoint was saved
+	time_t saved_time; // When the checkpoint was saved
+	char *head; // The lines of the checkpoint before the last one, see save_checkpoint
+	size_t head_size;
+	char *tail; // The last line of the checkpoint
+	size_t tail_size;
 	vamp_t common_count[COUNT_ARRAY_SIZE];
 	vamp_t common_prev[COUNT_ARRAY_SIZE]; // The last vampire number that got printed out.
 	struct hash *checksum;
@@ -32,9 +127,18 @@ struct taskboard
 
 void taskboard_new(struct taskboard **ptr, struct options_t options);
 void taskboard_free(struct taskboard *ptr);
-void taskboard_set(struct taskboard *ptr, vamp_t lmin, vamp_t lmax);
+void taskboard_set(struct taskboard *ptr, vamp_t complete, vamp_t max);
 struct task *taskboard_get_task(struct taskboard *ptr);
+bool taskboard_get_piece(struct taskboard *ptr, thread_t thread, struct piece *piece);
+bool taskboard_get_own_piece(struct taskboard *ptr, thread_t thread, struct piece *piece);
+void taskboard_finish_piece(struct taskboard *ptr, thread_t thread, struct piece *piece);
+void taskboard_complete(struct taskboard *ptr, struct task *task);
+void taskboard_stop(struct taskboard *ptr);
+void taskboard_yield(struct taskboard *ptr);
+void taskboard_finish(struct taskboard *ptr);
+bool taskboard_wait_complete(struct taskboard *ptr, const struct timespec *deadline);
 void taskboard_cleanup(struct taskboard *ptr, mtx_t *stdout_mtx);
+void taskboard_checkpoint(struct taskboard *ptr, bool force);
 void taskboard_print_results(struct taskboard *ptr);
 void taskboard_progress(struct taskboard *ptr, mtx_t *stdout_mtx);
 #endif /* HELSING_TASKBOARD_H */
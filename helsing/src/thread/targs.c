@@ -12,18 +12,20 @@
 #include "cache.h"
 #include "targs.h"
 #include "vargs.h"
+#include "affinity.h"
 
-#if MEASURE_RUNTIME
 #include <time.h>
-#endif
 
 void targs_new(
 	struct targs **ptr,
-	mtx_t *read,
+	thread_t thread,
+	int cpu,
 	mtx_t *write,
 	mtx_t *stdout_mtx,
+	struct pool *pool,
 	struct taskboard *progress,
 	struct cache *digptr,
+	const struct alphabet *alphabet,
 	bool dry_run)
 {
 	OPTIONAL_ASSERT(ptr != NULL);
@@ -33,12 +35,15 @@ void targs_new(
 	if (new == NULL)
 		abort();
 
-	new->read = read;
+	new->thread = thread;
+	new->cpu = cpu;
 	new->write = write;
 	new->stdout_mtx = stdout_mtx;
+	new->pool = pool;
 	new->progress = progress;
 	new->runtime = 0.0;
 	new->digptr = digptr;
+	new->alphabet = alphabet;
 	new->dry_run = dry_run;
 	targs_new_total(new, 0);
 	*ptr = new;
@@ -49,45 +54,96 @@ void targs_free(struct targs *ptr)
 	free(ptr);
 }
 
-int thread_function(void *void_args)
-{
-	struct targs *args = (struct targs *)void_args;
-	thread_timer_start(args);
-	struct vargs *vamp_args = NULL;
-	vargs_new(&(vamp_args), args->digptr, args->stdout_mtx);
-	struct task *current = NULL;
-
-	do {
-		current = NULL;
-// Critical section start
-		mtx_lock(args->read);
+/*
+ * thread_work:
+ *
+ * Returns true once the taskboard runs dry, or false if the worker was
+ * retired. A retiring worker finishes the pieces in its own deque first, no
+ * one else might be left to steal them.
+ *
+ * With TASK_CHECKPOINT, vampire() stops when the writer is about to save
+ * the tasks, see taskboard_yield, and the rest of the piece goes back to the
+ * deque.
+ */
 
-		current = taskboard_get_task(args->progress);
+static bool thread_work(struct targs *args, struct vargs *vamp_args)
+{
+	struct piece current;
+
+	while (true) {
+		if (args->thread >= atomic_load(&(args->pool->active))) {
+			if (!taskboard_get_own_piece(args->progress, args->thread, &current))
+				return false;
+		} else if (!taskboard_get_piece(args->progress, args->thread, &current)) {
+			return true;
+		}
 
-		mtx_unlock(args->read);
-// Critical section end
+		struct timespec start, finish;
+		timespec_get(&start, TIME_UTC);
+		if (!args->dry_run && current.lmin <= current.lmax && current.fmin <= current.fmax)
+			vampire(current.lmin, current.lmax, current.fmin, current.fmax, vamp_args);
+		timespec_get(&finish, TIME_UTC);
+		double runtime = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
 
-		if (current != NULL) {
-			if (!args->dry_run)
-				vampire(current->lmin, current->lmax, vamp_args, args->progress->fmax);
+		taskboard_finish_piece(args->progress, args->thread, &current);
 
 // Critical section start
-			mtx_lock(args->write);
+		mtx_lock(args->write);
 
-			task_copy_vargs(current, vamp_args);
 #if MEASURE_RUNTIME
-			args->total += current->count[0];
+		args->total += array_size(vamp_args->result);
 #endif
-			taskboard_cleanup(args->progress, args->stdout_mtx);
+		if (args->progress->task_checkpoint)
+			task_add_finished(current.task, &current);
+		bool complete = task_copy_vargs(current.task, vamp_args, runtime, &current);
 
-			mtx_unlock(args->write);
+		mtx_unlock(args->write);
 
 // Critical section end
-			vargs_reset(vamp_args);
+		if (complete)
+			taskboard_complete(args->progress, current.task);
+
+		vargs_reset(vamp_args);
+	}
+}
+
+int thread_function(void *void_args)
+{
+	struct targs *args = (struct targs *)void_args;
+	struct pool *pool = args->pool;
+	struct vargs *vamp_args = NULL;
+	affinity_apply(args->cpu);
+	vargs_new(&(vamp_args), args->digptr, args->alphabet, &(args->progress->runners[args->thread].multipliers), args->stdout_mtx);
+	size_t generation = 0; // The last one that ran dry on us
+
+	while (true) {
+		mtx_lock(&(pool->mtx));
+		while (!pool->shutdown && (pool->generation == generation || pool->dry || args->thread >= atomic_load(&(pool->active))))
+			cnd_wait(&(pool->work), &(pool->mtx));
+		size_t current = pool->generation;
+		bool shutdown = pool->shutdown;
+		if (!shutdown)
+			pool->busy += 1;
+		mtx_unlock(&(pool->mtx));
+
+		if (shutdown)
+			break;
+
+		thread_timer_start(args);
+		bool dry = thread_work(args, vamp_args);
+		thread_timer_stop(args);
+
+		mtx_lock(&(pool->mtx));
+		pool->busy -= 1;
+		if (dry) {
+			pool->dry = true;
+			generation = current;
 		}
-	} while (current != NULL);
+		if (pool->dry && pool->busy == 0)
+			cnd_signal(&(pool->idle));
+		mtx_unlock(&(pool->mtx));
+	}
 	vargs_free(vamp_args);
-	thread_timer_stop(args);
 	return 0;
 }
 
@@ -104,7 +160,7 @@ void thread_timer_stop(struct targs *ptr)
 	timespec_get(&(finish), TIME_UTC);
 	double elapsed = (finish.tv_sec - ptr->start.tv_sec);
 	elapsed += (finish.tv_nsec - ptr->start.tv_nsec) / 1000000000.0;
-	ptr->runtime = elapsed;
+	ptr->runtime += elapsed;
 }
 
 #endif /* MEASURE_RUNTIME */
@@ -8,24 +8,55 @@
 
 #include <threads.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
 #include "taskboard.h"
 #include "cache.h"
+#include "alphabet.h"
 
 #if MEASURE_RUNTIME
 #include <time.h>
 #endif
 
+/*
+ * pool:
+ *
+ * 	The worker threads live for the whole run. main() bumps the generation
+ * and wakes the workers, which go back to sleep once the taskboard runs dry.
+ * The last one to finish wakes main().
+ *
+ * 	Only the first active workers take pieces, the rest sleep. Lowering
+ * active retires the workers above it once they're done with the piece
+ * they're on; raising it wakes them to join in. The pieces left in the
+ * deques of retired workers are stolen by the others.
+ */
+
+struct pool
+{
+	mtx_t mtx;
+	cnd_t work; // Signalled on a new generation, shutdown, or more active workers
+	cnd_t idle; // Signalled when the last worker runs out of tasks
+	size_t generation;
+	atomic_size_t active;
+	unsigned long requested; // The number last read from the threads file
+	thread_t busy;
+	bool dry; // A worker has run out of pieces in this generation
+	bool shutdown;
+};
+
 struct targs
 {
-	mtx_t *read;
+	thread_t thread;
+	int cpu; // -1 if the thread isn't pinned
 	mtx_t *write;
 	mtx_t *stdout_mtx;
+	struct pool *pool;
 	struct taskboard *progress;
 	double	runtime;
 	struct cache *digptr;
+	const struct alphabet *alphabet;
 	bool dry_run;
 
 #if MEASURE_RUNTIME
@@ -36,11 +67,14 @@ struct targs
 
 void targs_new(
 	struct targs **ptr,
-	mtx_t *read,
+	thread_t thread,
+	int cpu,
 	mtx_t *write,
 	mtx_t *stdout_mtx,
+	struct pool *pool,
 	struct taskboard *progress,
 	struct cache *digptr,
+	const struct alphabet *alphabet,
 	bool dry_run);
 
 void targs_free(struct targs *ptr);
@@ -6,6 +6,10 @@
 #include <stdlib.h>
 #include <threads.h>
 #include <stdio.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <signal.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
@@ -14,6 +18,8 @@
 #include "cache.h"
 #include "targs.h"
 #include "targs_handle.h"
+#include "checkpoint.h"
+#include "affinity.h"
 
 void targs_handle_new(struct targs_handle **ptr, struct options_t options, vamp_t min, vamp_t max, struct taskboard *progress)
 {
@@ -33,12 +39,6 @@ void targs_handle_new(struct targs_handle **ptr, struct options_t options, vamp_
 	if (new->targs == NULL)
 		abort();
 
-	new->read = malloc(sizeof(mtx_t));
-	if (new->read == NULL)
-		abort();
-
-	mtx_init(new->read, mtx_plain);
-
 	new->write = malloc(sizeof(mtx_t));
 	if (new->write == NULL)
 		abort();
@@ -51,20 +51,270 @@ void targs_handle_new(struct targs_handle **ptr, struct options_t options, vamp_
 
 	mtx_init(new->stdout_mtx, mtx_plain);
 
+	mtx_init(&(new->pool.mtx), mtx_plain);
+	cnd_init(&(new->pool.work));
+	cnd_init(&(new->pool.idle));
+	new->pool.generation = 0;
+	atomic_init(&(new->pool.active), new->options.threads_active);
+	new->pool.requested = 0;
+	new->pool.busy = 0;
+	new->pool.dry = false;
+	new->pool.shutdown = false;
+	new->forced = false;
+
+	new->threads = malloc(sizeof(thrd_t) * new->options.threads);
+	if (new->threads == NULL)
+		abort();
+
+	int *cpus = malloc(sizeof(int) * new->options.threads);
+	if (cpus == NULL)
+		abort();
+	affinity_map(new->options.affinity, new->options.threads, cpus);
+
 	for (thread_t thread = 0; thread < new->options.threads; thread++) {
 		new->targs[thread] = NULL;
-		targs_new(&(new->targs[thread]), new->read, new->write, new->stdout_mtx, new->progress, new->digptr, new->options.dry_run);
+		targs_new(&(new->targs[thread]), thread, cpus[thread], new->write, new->stdout_mtx, &(new->pool), new->progress, new->digptr, &(new->options.digits), new->options.dry_run);
+		assert(thrd_create(&(new->threads[thread]), thread_function, (void *)(new->targs[thread])) == thrd_success);
 	}
+	free(cpus);
 	*ptr = new;
 }
 
+/*
+ * writer_deadline:
+ *
+ * 	When the writer has to wake up even if no task completes: to save a
+ * checkpoint that's behind, see CHECKPOINT_SECONDS, or to save the tasks at
+ * tasks_due. Returns NULL if there's no such time.
+ */
+
+static struct timespec *writer_deadline(struct taskboard *progress, time_t tasks_due, struct timespec *deadline)
+{
+	bool behind = (CHECKPOINT_SECONDS > 0 && progress->saved != progress->complete);
+	if (!behind && !progress->task_checkpoint)
+		return NULL;
+
+	deadline->tv_nsec = 0;
+	deadline->tv_sec = progress->saved_time + CHECKPOINT_SECONDS;
+	if (progress->task_checkpoint && (!behind || tasks_due < deadline->tv_sec))
+		deadline->tv_sec = tasks_due;
+	return deadline;
+}
+
+/*
+ * writer_function:
+ *
+ * 	Processes the complete tasks in order: prints and hashes the results,
+ * saves the checkpoint and shows the progress, so that the workers can go
+ * straight back to the next piece. With TASK_CHECKPOINT it also saves the
+ * tasks after the checkpoint every TASK_CHECKPOINT seconds, and once more
+ * at the end if the run was stopped. A second before a save, the running
+ * pieces are told to yield, see taskboard_yield, so that what they've done
+ * is saved too. The checkpoint is saved first, so that the tasks always
+ * start at or before it.
+ */
+
+static int writer_function(void *void_args)
+{
+	struct targs_handle *ptr = (struct targs_handle *)void_args;
+	struct taskboard *progress = ptr->progress;
+	struct timespec deadline;
+	time_t tasks_due = time(NULL) + TASK_CHECKPOINT - 1;
+	bool yielded = false;
+
+	while (taskboard_wait_complete(progress, writer_deadline(progress, tasks_due, &deadline))) {
+		taskboard_cleanup(progress, ptr->stdout_mtx);
+
+		time_t now = time(NULL);
+		if (!progress->task_checkpoint || now < tasks_due)
+			continue;
+
+		if (!yielded) {
+			taskboard_yield(progress);
+			yielded = true;
+			tasks_due = now + 1;
+			continue;
+		}
+		taskboard_checkpoint(progress, true);
+		mtx_lock(ptr->write);
+		save_tasks(ptr->options, progress);
+		mtx_unlock(ptr->write);
+		yielded = false;
+		tasks_due = now + TASK_CHECKPOINT - 1;
+	}
+	taskboard_cleanup(progress, ptr->stdout_mtx);
+	taskboard_checkpoint(progress, true);
+	if (progress->task_checkpoint && atomic_load(&(progress->stop))) {
+		mtx_lock(ptr->write);
+		save_tasks(ptr->options, progress);
+		mtx_unlock(ptr->write);
+	}
+	return 0;
+}
+
+/*
+ * pool_resize:
+ *
+ * 	Reads the number of active workers from the threads file, if there's
+ * one. A missing or unreadable file leaves it as it is, so that the file can
+ * be rewritten at any time. The workers are all started by targs_handle_new,
+ * so the file can't ask for more than options.threads of them.
+ */
+
+static void pool_resize(struct targs_handle *ptr)
+{
+	if (ptr->options.threads_file == NULL)
+		return;
+
+	FILE *fp = fopen(ptr->options.threads_file, "r");
+	if (fp == NULL)
+		return;
+
+	unsigned long threads = 0;
+	int rc = fscanf(fp, "%lu", &threads);
+	fclose(fp);
+	if (rc != 1 || threads == 0)
+		return;
+
+	if (threads > ptr->options.threads && threads != ptr->pool.requested)
+		fprintf(stderr, "%s asks for %lu thread(s), but only %u were started, see -t\n", ptr->options.threads_file, threads, ptr->options.threads);
+	ptr->pool.requested = threads;
+	if (threads > ptr->options.threads)
+		threads = ptr->options.threads;
+	if (threads == atomic_load(&(ptr->pool.active)))
+		return;
+
+	fprintf(stderr, "Running %lu of %u thread(s)\n", threads, ptr->options.threads);
+	atomic_store(&(ptr->pool.active), threads);
+	cnd_broadcast(&(ptr->pool.work));
+}
+
+/*
+ * stop_handler:
+ *
+ * 	Only sets flags for targs_handle_run. The first signal stops the run.
+ * The same signal again is ignored if it comes within a second, as timeout(1)
+ * sends it to both helsing and its process group. A different signal, or the
+ * same one later on, stops the run at once, and one more ends the program.
+ */
+
+static volatile sig_atomic_t stop_signal = 0;
+static volatile sig_atomic_t stop_force = 0;
+static time_t stop_time;
+
+static void stop_handler(int sig)
+{
+	if (stop_force) {
+		signal(sig, SIG_DFL);
+		raise(sig);
+		return;
+	}
+	if (stop_signal == 0) {
+		stop_time = time(NULL);
+		stop_signal = sig;
+	} else if (sig != stop_signal || time(NULL) - stop_time >= 2) {
+		stop_force = 1;
+	}
+	signal(sig, stop_handler); // Some systems reset the handler
+}
+
+/*
+ * pool_stop:
+ *
+ * 	Stops the taskboard on SIGTERM, SIGINT or once the time limit is up.
+ * Returns true if the run has to stop at once, see stop_handler.
+ */
+
+static bool pool_stop(struct targs_handle *ptr, time_t start)
+{
+	if (stop_force) {
+		mtx_lock(ptr->stdout_mtx);
+		fprintf(stderr, "Stopping at once, without waiting for the running tasks\n");
+		mtx_unlock(ptr->stdout_mtx);
+		taskboard_stop(ptr->progress);
+		ptr->forced = true;
+		return true;
+	}
+	if (atomic_load(&(ptr->progress->stop)))
+		return false;
+
+	const char *reason = NULL;
+	if (stop_signal == SIGTERM)
+		reason = "SIGTERM";
+	else if (stop_signal == SIGINT)
+		reason = "SIGINT";
+	else if (ptr->options.time_limit != 0 && (size_t)(time(NULL) - start) >= ptr->options.time_limit)
+		reason = "the time limit";
+	if (reason == NULL)
+		return false;
+
+	mtx_lock(ptr->stdout_mtx);
+	fprintf(stderr, "Stopping on %s, the running tasks are %s\n", reason, (ptr->progress->task_checkpoint ? "saved" : "finished first"));
+	mtx_unlock(ptr->stdout_mtx);
+	taskboard_stop(ptr->progress);
+	return false;
+}
+
+/*
+ * targs_handle_run:
+ *
+ * 	Wakes the workers for the interval on the taskboard, and waits until
+ * they've run out of tasks and the writer has processed them all. Meanwhile
+ * it checks the threads file, the signals and the time limit every RUN_POLL
+ * seconds, see pool_resize and pool_stop. If it has to stop at once, it only
+ * waits for the writer, and the workers are left running, see forced.
+ */
+
+void targs_handle_run(struct targs_handle *ptr)
+{
+	time_t start = time(NULL);
+	stop_signal = 0;
+	stop_force = 0;
+	signal(SIGTERM, stop_handler);
+	signal(SIGINT, stop_handler);
+
+	thrd_t writer;
+	assert(thrd_create(&writer, writer_function, (void *)ptr) == thrd_success);
+
+	mtx_lock(&(ptr->pool.mtx));
+	pool_resize(ptr);
+	ptr->pool.generation += 1;
+	ptr->pool.dry = false;
+	cnd_broadcast(&(ptr->pool.work));
+	while (!ptr->pool.dry || ptr->pool.busy > 0) {
+		struct timespec deadline;
+		timespec_get(&deadline, TIME_UTC);
+		deadline.tv_sec += RUN_POLL;
+		cnd_timedwait(&(ptr->pool.idle), &(ptr->pool.mtx), &deadline);
+		pool_resize(ptr);
+		if (pool_stop(ptr, start))
+			break;
+	}
+	mtx_unlock(&(ptr->pool.mtx));
+
+	taskboard_finish(ptr->progress);
+	thrd_join(writer, NULL);
+
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+}
+
 void targs_handle_free(struct targs_handle *ptr)
 {
 	if (ptr == NULL)
 		return;
 
-	mtx_destroy(ptr->read);
-	free(ptr->read);
+	mtx_lock(&(ptr->pool.mtx));
+	ptr->pool.shutdown = true;
+	cnd_broadcast(&(ptr->pool.work));
+	mtx_unlock(&(ptr->pool.mtx));
+	for (thread_t thread = 0; thread < ptr->options.threads; thread++)
+		thrd_join(ptr->threads[thread], 0);
+	free(ptr->threads);
+	cnd_destroy(&(ptr->pool.work));
+	cnd_destroy(&(ptr->pool.idle));
+	mtx_destroy(&(ptr->pool.mtx));
+
 	mtx_destroy(ptr->write);
 	free(ptr->write);
 	mtx_destroy(ptr->stdout_mtx);
@@ -82,9 +332,15 @@ void targs_handle_print(struct targs_handle *ptr)
 {
 #if MEASURE_RUNTIME
 	double total_time = 0.0;
-	fprintf(stderr, "Thread  Runtime Count\n");
+	bool pinned = (ptr->options.affinity != affinity_none);
+	fprintf(stderr, "Thread  %sRuntime Count\n", (pinned ? "CPU     " : ""));
 	for (thread_t thread = 0; thread < ptr->options.threads; thread++) {
-		fprintf(stderr, "%u\t%.2lfs\t", thread, ptr->targs[thread]->runtime);
+		fprintf(stderr, "%u\t", thread);
+		if (pinned && ptr->targs[thread]->cpu >= 0)
+			fprintf(stderr, "%d\t", ptr->targs[thread]->cpu);
+		else if (pinned)
+			fprintf(stderr, "-\t");
+		fprintf(stderr, "%.2lfs\t", ptr->targs[thread]->runtime);
 		helsing_fprint(stderr, "vs", ptr->targs[thread]->total, "\n");
 		total_time += ptr->targs[thread]->runtime;
 	}
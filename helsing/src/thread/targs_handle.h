@@ -6,6 +6,7 @@
 #ifndef HELSING_TARGS_HANDLE_H
 #define HELSING_TARGS_HANDLE_H
 
+#include <stdbool.h>
 #include <threads.h>
 
 #include "configuration.h"
@@ -20,12 +21,15 @@ struct targs_handle
 	struct targs **targs;
 	struct taskboard *progress;
 	struct cache *digptr;
-	mtx_t *read;
 	mtx_t *write;
 	mtx_t *stdout_mtx;
+	struct pool pool;
+	thrd_t *threads;
+	bool forced; // The workers were left running, see targs_handle_run
 };
 
 void targs_handle_new(struct targs_handle **ptr, struct options_t options, vamp_t min, vamp_t max, struct taskboard *progress);
 void targs_handle_free(struct targs_handle *ptr);
+void targs_handle_run(struct targs_handle *ptr);
 void targs_handle_print(struct targs_handle *ptr);
 #endif /* HELSING_TARGS_HANDLE_H */
@@ -55,11 +55,23 @@ void cache_new(struct cache **ptr, vamp_t min, vamp_t max)
 	if (new == NULL)
 		abort();
 
+	/*
+	 * Lengths that are checked by ALG_BITS or ALG_SWAR don't use dig[].
+	 */
+	length_t lenmax = length(max);
+	if (ALG_BITS_ACTIVE) {
+		lenmax = 0;
+		max = 0;
+	} else if (ALG_SWAR && lenmax >= SWAR_MIN_LENGTH) {
+		lenmax = SWAR_MIN_LENGTH - 1;
+		max = pow_v(lenmax) - 1;
+	}
+
 	new->overflow = cache_ovf_chk(max);
 	length_t cs = 0;
 	length_t i = length(min);
 
-	do {
+	while (i <= lenmax) {
 		length_t multiplicand_length =  div_roof(i, 2);
 		struct partdata_all_t data = {
 			.constant = {
@@ -104,7 +116,7 @@ void cache_new(struct cache **ptr, vamp_t min, vamp_t max)
 				cs = tmp;
 		}
 		i++;
-	} while (i <= length(max));
+	}
 	new->size = pow_v(cs);
 
 	new->dig = malloc(sizeof(digits_t) * new->size);
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <threads.h>
+#include <time.h>
 
 #include "configuration.h"
 #include "configuration_adv.h"
@@ -17,6 +18,7 @@
 #include "llnode.h"
 #include "array.h"
 #include "cache.h"
+#include "alphabet.h"
 #include "vargs.h"
 
 static bool notrailingzero(fang_t x)
@@ -24,84 +26,145 @@ static bool notrailingzero(fang_t x)
 	return ((x % BASE) != 0);
 }
 
-static fang_t sqrtv_floor(vamp_t x) // vamp_t sqrt to fang_t.
+/*
+ * residue_init:
+ *
+ * 	A product and its fangs share the same digits, therefore they also share
+ * the same sum of digits and are congruent modulo BASE - 1:
+ * 	multiplier + multiplicand == multiplier * multiplicand (mod BASE - 1)
+ *
+ * 	For every class of multiplier (mod BASE - 1) there is either no class of
+ * multiplicand that satisfies the congruence, or exactly one. We tabulate them
+ * once, so that the kernel can skip disqualified multipliers and start every
+ * multiplicand sequence on the right class.
+ *
+ * 	The other half of the residue sieve, modulo BASE, is the trailing zero
+ * rule. It is checked only on matches, see notrailingzero().
+ */
+
+static void residue_init(struct residue *ptr)
 {
-	vamp_t x2 = x / 2;
-	vamp_t root = x2;
-	if (root > 0) {
-		vamp_t tmp = (root + x / root) / 2;
-		while (tmp < root) {
-			root = tmp;
-			tmp = (root + x / root) / 2;
+	const digit_t mod = BASE - 1;
+
+	for (digit_t i = 0; i < mod; i++) {
+		ptr->admissible[i] = false;
+		ptr->multiplicand[i] = 0;
+		for (digit_t j = 0; j < mod; j++) {
+			if ((i + j) % mod == (i * j) % mod) {
+				ptr->admissible[i] = true;
+				ptr->multiplicand[i] = j;
+				break;
+			}
 		}
-		return root;
 	}
-	return x;
 }
 
-static fang_t sqrtv_roof(vamp_t x)
+// First multiplicand >= min, that belongs to the admissible class.
+static fang_t residue_first(const struct residue *ptr, digit_t multiplier_class, fang_t min)
 {
-	if (x == 0)
-		return 0;
+	const digit_t mod = BASE - 1;
+	digit_t target = ptr->multiplicand[multiplier_class];
+	digit_t current = min % mod;
 
-	fang_t root = sqrtv_floor(x);
-	if (root == FANG_MAX())
-		return root;
+	fang_t offset = (target + mod - current) % mod;
+	if (offset > FANG_MAX() - min)
+		return FANG_MAX();
 
-	return (x / root);
+	return (min + offset);
+}
+
+void multipliers_init(struct multipliers *ptr)
+{
+	mtx_init(&(ptr->mtx), mtx_plain);
+	ptr->min = 0;
+	ptr->max = 0;
+	ptr->active = false;
+	ptr->yielded = false;
+	ptr->stop = false;
+	atomic_init(&(ptr->yield), false);
+}
+
+void multipliers_destroy(struct multipliers *ptr)
+{
+	mtx_destroy(&(ptr->mtx));
+}
+
+static void multipliers_open(struct multipliers *ptr, fang_t min, fang_t max)
+{
+	mtx_lock(&(ptr->mtx));
+	ptr->min = min;
+	ptr->max = max;
+	ptr->active = (min <= max);
+	ptr->yielded = false;
+	mtx_unlock(&(ptr->mtx));
 }
 
 /*
- * disqualify_mult:
+ * multipliers_claim:
  *
- * Disqualify ineligible values before congruence_check.
- * Currently suppoted numerical bases: 2~10.
+ * 	Claims the next block [*block_min, ret] from the top, returns 0 if
+ * there's nothing left. Blocks are claimed in descending order without gaps,
+ * splits only ever take multipliers from the bottom. If yield or stop is
+ * set the rest of the multipliers are left unclaimed.
  */
 
-static bool disqualify_mult(vamp_t x)
+static fang_t multipliers_claim(struct multipliers *ptr, fang_t *block_min)
 {
-	bool ret = false;
-	switch (BASE) {
-		case 2:
-			ret = false;
-			break;
-		case 7:	{
-			digit_t tmp = x % (BASE - 1);
-			ret = (tmp == 1 || tmp == 3 || tmp == 4 || tmp == 5);
-			break;
-		}
-		case 10:
-			ret = (x % 3 == 1);
-			break;
-		default:
-			/*
-			 * A represents the last bit of multiplier
-			 * B represents the last bit of multiplicand
-			 *
-			 * A B  A+B  A*B  Match
-			 * 0 0   0    0   true
-			 * 0 1   1    0   false
-			 * 1 0   1    0   false
-			 * 1 1 (1)0   1   false
-			 *
-			 * If BASE-1 is a power of two, we can safely disqualify
-			 * the cases where A is 1.
-			 */
-			if (((BASE - 1) & (BASE - 2)) == 0)
-				ret = x % 2;
-			else
-				ret = (x % (BASE - 1) == 1);
+	fang_t ret = 0;
+	mtx_lock(&(ptr->mtx));
+	if (ptr->active && (atomic_exchange(&(ptr->yield), false) || ptr->stop)) {
+		ptr->active = false;
+		ptr->yielded = true;
+	} else if (ptr->active) {
+		ret = ptr->max;
+		*block_min = ptr->min;
+		if (ptr->max - ptr->min >= MULTIPLIER_BLOCK)
+			*block_min = ptr->max - (MULTIPLIER_BLOCK - 1);
+
+		if (*block_min == ptr->min)
+			ptr->active = false;
+		else
+			ptr->max = *block_min - 1;
 	}
+	mtx_unlock(&(ptr->mtx));
 	return ret;
 }
 
-// Modulo base-1 lack of congruence
-static bool congruence_check(vamp_t x, vamp_t y)
+/*
+ * multipliers_split:
+ *
+ * Takes the bottom half [*min, *max] of the multipliers that haven't been
+ * claimed, if there are enough of them. Requires mutex lock.
+ */
+
+bool multipliers_split(struct multipliers *ptr, fang_t *min, fang_t *max)
+{
+	if (!ptr->active || ptr->max - ptr->min < 2 * MULTIPLIER_BLOCK)
+		return false;
+
+	*min = ptr->min;
+	*max = ptr->min + (ptr->max - ptr->min) / 2;
+	ptr->min = *max + 1;
+	return true;
+}
+
+/*
+ * multipliers_yielded:
+ *
+ * 	Returns true if the last vampire() call stopped early, with the
+ * highest multiplier it didn't reach in *max, and clears the flag. Requires
+ * mutex lock.
+ */
+
+bool multipliers_yielded(struct multipliers *ptr, fang_t *max)
 {
-	return ((x + y) % (BASE - 1) != (x * y) % (BASE - 1));
+	bool ret = ptr->yielded;
+	*max = ptr->max;
+	ptr->yielded = false;
+	return ret;
 }
 
-void vargs_new(struct vargs **ptr, struct cache *digptr, mtx_t *stdout_mtx)
+void vargs_new(struct vargs **ptr, struct cache *digptr, const struct alphabet *alphabet, struct multipliers *multipliers, mtx_t *stdout_mtx)
 {
 	OPTIONAL_ASSERT(ptr != NULL);
 	OPTIONAL_ASSERT(*ptr == NULL);
@@ -111,7 +174,10 @@ void vargs_new(struct vargs **ptr, struct cache *digptr, mtx_t *stdout_mtx)
 		abort();
 
 	new->digptr = digptr;
+	new->alphabet = alphabet;
+	new->multipliers = multipliers;
 	new->stdout_mtx = stdout_mtx;
+	residue_init(&(new->residue));
 	memset(new->local_count, 0, sizeof(new->local_count));
 	new->result = NULL;
 	*ptr = new;
@@ -395,6 +461,375 @@ static void alg_cache_iterate_all(struct alg_cache *ptr)
 
 #endif /* ALG_CACHE */
 
+#if ALG_SWAR // when false we use the empty functions in vargs.h
+
+/*
+ * Digits are stored in lanes of SWAR_BITS bits, least significant digit first.
+ * Bases up to 16 use 4-bit lanes, 16 digits per 64-bit word:
+ * 	1234567890 -> [0] 0x0000001234567890
+ *
+ * Larger bases use 8-bit lanes, 8 digits per word.
+ */
+
+#if (BASE <= 16)
+	#define SWAR_BITS 4
+	#define SWAR_LANE_ONES UINT64_C(0x1111111111111111)
+#else
+	#define SWAR_BITS 8
+	#define SWAR_LANE_ONES UINT64_C(0x0101010101010101)
+#endif
+#define SWAR_LANES (64 / SWAR_BITS)
+#define SWAR_LANE_BIAS ((UINT64_C(1) << SWAR_BITS) - BASE)
+
+// In base 2, vamp_t has sizeof(vamp_t) * CHAR_BIT digits.
+#define SWAR_WORDS ((sizeof(vamp_t) * CHAR_BIT + SWAR_LANES - 1) / SWAR_LANES)
+
+// Byte lanes, used when counting.
+#define SWAR_ONES  UINT64_C(0x0101010101010101)
+#define SWAR_LOW   (SWAR_ONES * 0x0f)
+#define SWAR_HIGH  (SWAR_ONES * 0x80)
+#define SWAR_EVEN  UINT64_C(0x00ff00ff00ff00ff)
+#define SWAR_BIAS(x) (SWAR_ONES * (0x80 - (x))) // bytes >= x get their high bit set
+
+struct alg_swar
+{
+	length_t words; // words of the product
+	length_t multiplicand_words;
+	digit_t order[BASE]; // the order in which we compare the digits
+
+	// doesn't change when we iterate
+	length_t mult_sum;
+	length_t mult_atleast[BASE];
+
+	uint64_t multiplicand[SWAR_WORDS];
+	uint64_t multiplicand_iterator[SWAR_WORDS];
+	uint64_t product[SWAR_WORDS];
+	uint64_t product_iterator[SWAR_WORDS];
+};
+
+static void swar_set(uint64_t *arr, length_t words, vamp_t number)
+{
+	for (length_t i = 0; i < words; i++) {
+		uint64_t word = 0;
+		for (length_t j = 0; j < SWAR_LANES && number > 0; j++) {
+			word |= ((uint64_t)(number % BASE)) << (SWAR_BITS * j);
+			number /= BASE;
+		}
+		arr[i] = word;
+	}
+}
+
+/*
+ * The iterators are stored with 2^SWAR_BITS - BASE added to every lane, see
+ * swar_add.
+ */
+
+static void swar_set_iterator(uint64_t *arr, length_t words, vamp_t number)
+{
+	swar_set(arr, words, number);
+	for (length_t i = 0; i < words; i++)
+		arr[i] += SWAR_LANE_ONES * SWAR_LANE_BIAS;
+}
+
+/*
+ * swar_add:
+ *
+ * 	a += b, digit by digit, where b is an iterator. Because of the extra
+ * 2^SWAR_BITS - BASE, the lanes that reach BASE overflow into the next lane,
+ * so the 64-bit adder propagates the carries for us. The lanes that didn't
+ * overflow get their 2^SWAR_BITS - BASE back. None of this branches.
+ */
+
+static inline void swar_add(uint64_t *a, const uint64_t *b, length_t words)
+{
+	uint64_t carry = 0;
+	for (length_t i = 0; i < words; i++) {
+		uint64_t tmp = a[i] + carry; // the top lane of a is < BASE, no overflow
+		uint64_t sum = tmp + b[i];
+		carry = (sum < tmp);
+
+		// A carry into bit SWAR_BITS * (k + 1) is a carry out of lane k.
+		uint64_t carries = ((tmp ^ b[i] ^ sum) >> SWAR_BITS) & SWAR_LANE_ONES;
+		carries |= carry << (64 - SWAR_BITS);
+
+		a[i] = sum - (~carries & SWAR_LANE_ONES) * SWAR_LANE_BIAS;
+	}
+}
+
+/*
+ * Counting is done on byte lanes. The lanes are summed up across words first,
+ * and then across the lanes with a single multiplication.
+ */
+
+// Sum of the digits
+static inline length_t swar_sum(const uint64_t *arr, length_t words)
+{
+	uint64_t lanes = 0; // 8-bit
+	for (length_t i = 0; i < words; i++) {
+#if (SWAR_BITS == 4)
+		lanes += (arr[i] & SWAR_LOW) + ((arr[i] >> 4) & SWAR_LOW);
+#else
+		lanes += (arr[i] & SWAR_EVEN) + ((arr[i] >> 8) & SWAR_EVEN);
+#endif
+	}
+#if (SWAR_BITS == 4)
+	lanes = (lanes & SWAR_EVEN) + ((lanes >> 8) & SWAR_EVEN);
+#endif
+	return ((lanes * UINT64_C(0x0001000100010001)) >> 48);
+}
+
+// Count the digits that are >= x, where bias is SWAR_BIAS(x)
+static inline length_t swar_atleast(const uint64_t *arr, length_t words, uint64_t bias)
+{
+	uint64_t lanes = 0; // 8-bit
+	for (length_t i = 0; i < words; i++) {
+#if (SWAR_BITS == 4)
+		lanes += (((arr[i] & SWAR_LOW) + bias) & SWAR_HIGH) >> 7;
+		lanes += ((((arr[i] >> 4) & SWAR_LOW) + bias) & SWAR_HIGH) >> 7;
+#else
+		lanes += ((arr[i] + bias) & SWAR_HIGH) >> 7;
+#endif
+	}
+	return ((lanes * SWAR_ONES) >> 56);
+}
+
+static inline void alg_swar_init(struct alg_swar *ptr, length_t lenmax)
+{
+	// One more lane for the carry of the last iteration.
+	ptr->words = div_roof(lenmax + 1, SWAR_LANES);
+	ptr->multiplicand_words = div_roof(div_roof(lenmax, 2) + 1, SWAR_LANES);
+
+	/*
+	 * Thresholds near the middle split the digits most evenly, they are
+	 * the most likely to tell two numbers apart: 5, 4, 6, 3, 7, 2, 8, 1, 9
+	 */
+	digit_t middle = (BASE + 1) / 2;
+	for (digit_t i = 0; i < BASE - 1; i++) {
+		if (i % 2 == 0)
+			ptr->order[i] = middle + i / 2;
+		else
+			ptr->order[i] = middle - (i + 1) / 2;
+	}
+}
+
+static void alg_swar_set(
+	struct alg_swar *ptr,
+	fang_t multiplier,
+	fang_t multiplicand,
+	vamp_t product,
+	vamp_t product_iterator)
+{
+	ptr->mult_sum = 0;
+	for (digit_t i = 0; i < BASE; i++)
+		ptr->mult_atleast[i] = 0;
+	for (fang_t i = multiplier; i > 0; i /= BASE) {
+		digit_t digit = i % BASE;
+		ptr->mult_sum += digit;
+		for (digit_t j = 1; j <= digit; j++)
+			ptr->mult_atleast[j] += 1;
+	}
+
+	swar_set(ptr->multiplicand, ptr->multiplicand_words, multiplicand);
+	swar_set_iterator(ptr->multiplicand_iterator, ptr->multiplicand_words, BASE - 1);
+	swar_set(ptr->product, ptr->words, product);
+	swar_set_iterator(ptr->product_iterator, ptr->words, product_iterator);
+}
+
+/*
+ * alg_swar_check:
+ *
+ * 	Product and fangs have the same length. They have the same digits, if for
+ * every digit x they have the same amount of digits >= x. Before that, the sum
+ * of the digits rejects most of the non-matches.
+ */
+
+static void alg_swar_check(struct alg_swar *ptr, int *result)
+{
+	length_t fangs = ptr->mult_sum + swar_sum(ptr->multiplicand, ptr->multiplicand_words);
+	if (swar_sum(ptr->product, ptr->words) != fangs)
+		return;
+
+	for (digit_t i = 0; i < BASE - 1; i++) {
+		digit_t digit = ptr->order[i];
+		uint64_t bias = SWAR_BIAS(digit);
+		fangs = ptr->mult_atleast[digit];
+		fangs += swar_atleast(ptr->multiplicand, ptr->multiplicand_words, bias);
+		if (swar_atleast(ptr->product, ptr->words, bias) != fangs)
+			return;
+	}
+	(*result) += 1;
+}
+
+static void alg_swar_iterate_all(struct alg_swar *ptr)
+{
+	swar_add(ptr->multiplicand, ptr->multiplicand_iterator, ptr->multiplicand_words);
+	swar_add(ptr->product, ptr->product_iterator, ptr->words);
+}
+
+#endif /* ALG_SWAR */
+
+#if ALG_BITS_ACTIVE // when false we use the empty functions in vargs.h
+
+/*
+ * Numbers are split in words of whole digits, least significant first. In
+ * BASE 8 a word holds 21 digits, 63 bits:
+ * 	01234567 -> [0] 0x0000000000053977
+ */
+
+#define BITS_LANES (64 / BASE_BITS) // digits per word
+#define BITS_WORD_BITS (BITS_LANES * BASE_BITS)
+#define BITS_WORD_MASK (UINT64_MAX >> (64 - BITS_WORD_BITS))
+
+struct alg_bits
+{
+	length_t words; // words of the product
+	length_t multiplicand_words;
+	uint64_t lane_ones; // the lowest bit of every digit
+
+	// product and multiplicand fit in one word, see alg_bits_check
+	bool packed;
+	length_t product_bits;
+	uint64_t multiplicand_mask;
+	uint64_t packed_offset;
+
+	// doesn't change when we iterate
+	uint64_t mult_planes;
+	length_t mult_count[BASE];
+};
+
+static inline uint64_t bits_word(vamp_t number, length_t index)
+{
+	return ((uint64_t)(number >> (index * BITS_WORD_BITS))) & BITS_WORD_MASK;
+}
+
+// Count the digits of word that are equal to digit (digit > 0)
+static inline length_t bits_count(uint64_t word, digit_t digit, uint64_t lane_ones)
+{
+	uint64_t match = lane_ones;
+	for (length_t bit = 0; bit < BASE_BITS; bit++) {
+		if ((digit >> bit) & 1)
+			match &= word >> bit;
+		else
+			match &= ~(word >> bit);
+	}
+	return popcount64(match);
+}
+
+/*
+ * For every bit of the digits, count the digits that have it set. The counts
+ * are packed in 8-bit fields so that they can be compared at once.
+ */
+
+static inline uint64_t bits_planes_word(uint64_t word, uint64_t lane_ones)
+{
+	uint64_t ret = 0;
+	for (length_t bit = 0; bit < BASE_BITS; bit++)
+		ret += ((uint64_t)popcount64(word & (lane_ones << bit))) << (8 * bit);
+	return ret;
+}
+
+static inline uint64_t bits_planes(vamp_t number, length_t words, uint64_t lane_ones)
+{
+	if (words == 1) // skip the shifts of vamp_t
+		return bits_planes_word(((uint64_t)number) & BITS_WORD_MASK, lane_ones);
+
+	uint64_t ret = 0;
+	for (length_t i = 0; i < words; i++)
+		ret += bits_planes_word(bits_word(number, i), lane_ones);
+	return ret;
+}
+
+static inline length_t bits_digit_count(vamp_t number, length_t words, digit_t digit, uint64_t lane_ones)
+{
+	length_t ret = 0;
+	for (length_t i = 0; i < words; i++)
+		ret += bits_count(bits_word(number, i), digit, lane_ones);
+	return ret;
+}
+
+static inline void alg_bits_init(struct alg_bits *ptr, length_t lenmax)
+{
+	ptr->words = div_roof(lenmax, BITS_LANES);
+	ptr->multiplicand_words = div_roof(div_roof(lenmax, 2), BITS_LANES);
+
+	ptr->lane_ones = 0;
+	for (length_t i = 0; i < BITS_LANES; i++)
+		ptr->lane_ones |= UINT64_C(1) << (i * BASE_BITS);
+
+	length_t multiplicand_length = div_roof(lenmax, 2);
+	ptr->packed = (lenmax + multiplicand_length <= BITS_LANES);
+	ptr->product_bits = lenmax * BASE_BITS;
+	ptr->multiplicand_mask = 0;
+	ptr->packed_offset = 0;
+	if (ptr->packed) {
+		ptr->multiplicand_mask = BITS_WORD_MASK >> (BITS_WORD_BITS - multiplicand_length * BASE_BITS);
+		for (length_t bit = 0; bit < BASE_BITS; bit++)
+			ptr->packed_offset += ((uint64_t)multiplicand_length) << (8 * bit);
+	}
+}
+
+static void alg_bits_set(struct alg_bits *ptr, fang_t multiplier)
+{
+	ptr->mult_planes = bits_planes(multiplier, ptr->multiplicand_words, ptr->lane_ones);
+	for (digit_t digit = 1; digit < BASE; digit++)
+		ptr->mult_count[digit] = bits_digit_count(multiplier, ptr->multiplicand_words, digit, ptr->lane_ones);
+}
+
+/*
+ * alg_bits_check:
+ *
+ * 	First compare how many digits have each bit set, one popcount per bit and
+ * a single branch. In BASE 2 that's the whole check.
+ *
+ * 	When the product and the multiplicand fit in one word, the multiplicand is
+ * inverted and placed above the product. Each of its digits that has a bit set
+ * is now missing from the count, and one popcount per bit covers both numbers:
+ * 	planes(product) == planes(multiplier) + planes(multiplicand)
+ * 	planes(product) + length(multiplicand) - planes(multiplicand) == planes(multiplier) + length(multiplicand)
+ *
+ * 	Then compare the amount of every digit but one: if everything else is the
+ * same, so is the last digit. Zeros are implied by the length.
+ */
+
+static void alg_bits_check(struct alg_bits *ptr, fang_t multiplicand, vamp_t product, int *result)
+{
+	if (ptr->packed) {
+		uint64_t word = (uint64_t)product;
+		word |= (~((uint64_t)multiplicand) & ptr->multiplicand_mask) << ptr->product_bits;
+		if (bits_planes_word(word, ptr->lane_ones) != ptr->mult_planes + ptr->packed_offset)
+			return;
+	} else {
+		uint64_t planes = ptr->mult_planes + bits_planes(multiplicand, ptr->multiplicand_words, ptr->lane_ones);
+		if (bits_planes(product, ptr->words, ptr->lane_ones) != planes)
+			return;
+	}
+
+	for (digit_t digit = 1; digit < BASE - 1; digit++) {
+		length_t fangs = ptr->mult_count[digit];
+		fangs += bits_digit_count(multiplicand, ptr->multiplicand_words, digit, ptr->lane_ones);
+		if (bits_digit_count(product, ptr->words, digit, ptr->lane_ones) != fangs)
+			return;
+	}
+	(*result) += 1;
+}
+
+#endif /* ALG_BITS_ACTIVE */
+
+static bool alg_bits_active()
+{
+	return ALG_BITS_ACTIVE;
+}
+
+static bool alg_swar_active(length_t product_length)
+{
+	if (!ALG_SWAR)
+		return false;
+	if (!(ALG_NORMAL || ALG_CACHE))
+		return true;
+
+	return (product_length >= SWAR_MIN_LENGTH);
+}
+
 enum vampire_storage {none_e, vampire_e, msentence_e};
 
 static inline void msentence_to_vampire(struct vargs* args, struct llmsentence_t **ll_msentence, struct llvamp_t **ll_vampire)
@@ -421,8 +856,179 @@ static inline void msentence_to_vampire(struct vargs* args, struct llmsentence_t
 	}
 }
 
-void vampire(vamp_t min, vamp_t max, struct vargs *args, fang_t fmax)
+/*
+ * vampire_alphabet:
+ *
+ * 	When the fangs may only use some of the digits, most of the interval
+ * can't produce a match, so rather than sieve it we walk the numerals of
+ * the alphabet directly: multipliers downwards from fmax, multiplicands
+ * upwards from min / multiplier. Each step lands on the next fang that is
+ * made of allowed digits, the residue sieve still applies, and every
+ * candidate gets the exact digit comparison of ALG_NORMAL. The product needs
+ * no separate alphabet check, a match has the same digits as its fangs.
+ */
+
+static void vampire_alphabet(vamp_t min, vamp_t max, fang_t fmin, fang_t fmax, struct vargs *args)
 {
+	struct llvamp_t *ll_vampire = NULL;
+	llvamp_new(&ll_vampire, NULL);
+
+	length_t product_length = length(max);
+	if (product_length % 2 != 0 || length(min) != product_length)
+		goto out;
+
+	length_t fang_length = product_length / 2;
+	fang_t min_sqrt = sqrtv_roof(min);
+	fang_t max_sqrt = sqrtv_floor(max);
+	length_t mult_array[BASE];
+
+	struct alphabet_numeral multiplier;
+	struct alphabet_numeral multiplicand;
+	if (!alphabet_numeral_floor(&multiplier, args->alphabet, fang_length, fmax))
+		goto out;
+
+	do {
+		if (multiplier.value < min_sqrt || multiplier.value < fmin)
+			break;
+
+		digit_t multiplier_class = multiplier.value % (BASE - 1);
+		if (!args->residue.admissible[multiplier_class])
+			continue;
+
+		fang_t multiplicand_max;
+		if (multiplier.value > max_sqrt)
+			multiplicand_max = max / multiplier.value;
+		else
+			multiplicand_max = multiplier.value;
+
+		if (!alphabet_numeral_ceil(&multiplicand, args->alphabet, fang_length, div_roof(min, multiplier.value)))
+			continue;
+
+		bool mult_zero = notrailingzero(multiplier.value);
+		digit_t multiplicand_class = args->residue.multiplicand[multiplier_class];
+		alg_normal_set(multiplier.value, &mult_array);
+
+		do {
+			if (multiplicand.value > multiplicand_max)
+				break;
+			if (multiplicand.value % (BASE - 1) != multiplicand_class)
+				continue;
+
+			vamp_t product = multiplier.value;
+			product *= multiplicand.value;
+
+			int result = 0;
+			alg_normal_check(mult_array, multiplicand.value, product, &result);
+			if (result && (mult_zero || notrailingzero(multiplicand.value))) {
+				vargs_iterate_local_count(args);
+				vargs_print_results(args->stdout_mtx, product, multiplier.value, multiplicand.value);
+				llvamp_add(&(ll_vampire), product);
+			}
+		} while (alphabet_numeral_next(&multiplicand));
+	} while (alphabet_numeral_prev(&multiplier));
+
+out:
+	array_new(&(args->result), &ll_vampire);
+	llvamp_free(ll_vampire);
+}
+
+/*
+ * vampire_multiset:
+ *
+ * 	When the digits of the number are given, the multipliers are the
+ * numerals of the alphabet that don't use any digit more often than the
+ * multiset, and each one leaves exactly the digits of its multiplicands:
+ * we only walk their permutations, upwards from min / multiplier. The
+ * multiplicand's digit sum is then fixed, so the residue sieve rules out all
+ * of its permutations at once. A match is a product with the same digits as
+ * the multiset.
+ */
+
+static void vampire_multiset(vamp_t min, vamp_t max, fang_t fmin, fang_t fmax, struct vargs *args)
+{
+	struct llvamp_t *ll_vampire = NULL;
+	llvamp_new(&ll_vampire, NULL);
+
+	const struct alphabet *alphabet = args->alphabet;
+	length_t product_length = length(max);
+	if (product_length != alphabet->length || length(min) != product_length)
+		goto out;
+
+	length_t fang_length = product_length / 2;
+	fang_t min_sqrt = sqrtv_roof(min);
+	fang_t max_sqrt = sqrtv_floor(max);
+
+	struct alphabet_numeral multiplier;
+	struct alphabet_numeral multiplicand;
+	if (!alphabet_numeral_floor(&multiplier, alphabet, fang_length, fmax))
+		goto out;
+
+	do {
+		if (multiplier.value < min_sqrt || multiplier.value < fmin)
+			break;
+		if (!alphabet_numeral_fits(&multiplier, alphabet->count))
+			continue;
+
+		digit_t multiplier_class = multiplier.value % (BASE - 1);
+		if (!args->residue.admissible[multiplier_class])
+			continue;
+
+		length_t rest[BASE];
+		memcpy(rest, alphabet->count, sizeof(rest));
+		vamp_t rest_sum = 0;
+		for (fang_t m = multiplier.value; m > 0; m /= BASE)
+			rest[m % BASE] -= 1;
+		for (digit_t i = 0; i < BASE; i++)
+			rest_sum += (vamp_t)i * rest[i];
+		if (rest_sum % (BASE - 1) != args->residue.multiplicand[multiplier_class])
+			continue;
+
+		fang_t multiplicand_max;
+		if (multiplier.value > max_sqrt)
+			multiplicand_max = max / multiplier.value;
+		else
+			multiplicand_max = multiplier.value;
+
+		if (!alphabet_numeral_ceil_exact(&multiplicand, alphabet, rest, fang_length, div_roof(min, multiplier.value)))
+			continue;
+
+		bool mult_zero = notrailingzero(multiplier.value);
+		do {
+			if (multiplicand.value > multiplicand_max)
+				break;
+			if (!mult_zero && !notrailingzero(multiplicand.value))
+				continue;
+
+			vamp_t product = multiplier.value;
+			product *= multiplicand.value;
+
+			length_t product_array[BASE] = {0};
+			for (vamp_t p = product; p > 0; p /= BASE)
+				product_array[p % BASE] += 1;
+			if (memcmp(product_array, alphabet->count, sizeof(product_array)) == 0) {
+				vargs_iterate_local_count(args);
+				vargs_print_results(args->stdout_mtx, product, multiplier.value, multiplicand.value);
+				llvamp_add(&(ll_vampire), product);
+			}
+		} while (alphabet_numeral_next_exact(&multiplicand));
+	} while (alphabet_numeral_prev(&multiplier));
+
+out:
+	array_new(&(args->result), &ll_vampire);
+	llvamp_free(ll_vampire);
+}
+
+void vampire(vamp_t min, vamp_t max, fang_t fmin, fang_t fmax, struct vargs *args)
+{
+	if (args->alphabet->multiset) {
+		vampire_multiset(min, max, fmin, fmax, args);
+		return;
+	}
+	if (args->alphabet->restricted) {
+		vampire_alphabet(min, max, fmin, fmax, args);
+		return;
+	}
+
 	struct llmsentence_t *ll_msentence = NULL;
 	llmsentence_new(&ll_msentence, NULL);
 	struct llvamp_t *ll_vampire = NULL;
@@ -438,9 +1044,19 @@ void vampire(vamp_t min, vamp_t max, struct vargs *args, fang_t fmax)
 	};
 	size_t msentence_count = 0;
 
-	struct alg_cache ag_data;
+	struct alg_cache ag_data = {0};
 	alg_cache_init(&ag_data, length(max), args->digptr);
 
+	struct alg_swar sw_data = {0};
+	alg_swar_init(&sw_data, length(max));
+	bool use_swar = alg_swar_active(length(max));
+
+	struct alg_bits bt_data = {0};
+	alg_bits_init(&bt_data, length(max));
+	bool use_bits = alg_bits_active();
+	if (use_bits)
+		use_swar = false;
+
 	length_t mult_array[BASE];
 
 	int store_to = none_e;
@@ -448,68 +1064,99 @@ void vampire(vamp_t min, vamp_t max, struct vargs *args, fang_t fmax)
 		store_to = msentence_e;
 	if (ALG_CACHE && alg_cache_store_vamp(&ag_data))
 		store_to = vampire_e;
+	if (use_swar || use_bits)
+		store_to = vampire_e;
 
-	for (msentence.multiplier = fmax; msentence.multiplier >= min_sqrt && msentence.multiplier > 0; msentence.multiplier--) {
-		if (disqualify_mult(msentence.multiplier))
-			continue;
-
-		msentence.multiplicand = div_roof(min, msentence.multiplier); // fmin * fmax <= min - BASE^n
-		bool mult_zero = notrailingzero(msentence.multiplier);
-
-		fang_t multiplicand_max;
-		if (msentence.multiplier > max_sqrt)
-			multiplicand_max = max / msentence.multiplier;
-		else
-			multiplicand_max = msentence.multiplier;
-			// multiplicand <= multiplier: 5267275776 = 72576 * 72576.
-
-		while (msentence.multiplicand <= multiplicand_max && congruence_check(msentence.multiplier, msentence.multiplicand))
-			msentence.multiplicand++;
-
-		if (msentence.multiplicand > multiplicand_max)
-			continue;
-		/*
-		 * If multiplier has n digits, then product_iterator has at most n+1 digits.
-		 */
-		vamp_t product_iterator = msentence.multiplier;
-		product_iterator *= BASE - 1; // <= (BASE-1) * (2^32)
-		msentence.product = msentence.multiplier;
-		msentence.product *= msentence.multiplicand; // avoid overflow
+	if (fmin < min_sqrt)
+		fmin = min_sqrt;
+	if (fmin == 0)
+		fmin = 1;
+	multipliers_open(args->multipliers, fmin, fmax);
+
+	// Every block picks up where the previous one ended.
+	fang_t multiplier_min;
+	fang_t multiplier_max;
+	digit_t multiplier_class = fmax % (BASE - 1);
+	while ((multiplier_max = multipliers_claim(args->multipliers, &multiplier_min)) > 0) {
+		for (msentence.multiplier = multiplier_max; msentence.multiplier >= multiplier_min; msentence.multiplier--) {
+			digit_t current_class = multiplier_class;
+			multiplier_class = (multiplier_class + (BASE - 1) - 1) % (BASE - 1);
+
+			if (!args->residue.admissible[current_class])
+				continue;
+
+			bool mult_zero = notrailingzero(msentence.multiplier);
+
+			fang_t multiplicand_max;
+			if (msentence.multiplier > max_sqrt)
+				multiplicand_max = max / msentence.multiplier;
+			else
+				multiplicand_max = msentence.multiplier;
+				// multiplicand <= multiplier: 5267275776 = 72576 * 72576.
 
-		alg_cache_set(&ag_data, msentence.multiplier, msentence.multiplicand, msentence.product, product_iterator);
+			// fmin * fmax <= min - BASE^n
+			msentence.multiplicand = residue_first(&(args->residue), current_class, div_roof(min, msentence.multiplier));
 
-		if (ALG_NORMAL == true)
-			alg_normal_set(msentence.multiplier, &mult_array);
+			if (msentence.multiplicand > multiplicand_max)
+				continue;
+			/*
+			 * If multiplier has n digits, then product_iterator has at most n+1 digits.
+			 */
+			vamp_t product_iterator = msentence.multiplier;
+			product_iterator *= BASE - 1; // <= (BASE-1) * (2^32)
+			msentence.product = msentence.multiplier;
+			msentence.product *= msentence.multiplicand; // avoid overflow
+
+			if (use_bits) {
+				alg_bits_set(&bt_data, msentence.multiplier);
+			} else if (use_swar) {
+				alg_swar_set(&sw_data, msentence.multiplier, msentence.multiplicand, msentence.product, product_iterator);
+			} else {
+				alg_cache_set(&ag_data, msentence.multiplier, msentence.multiplicand, msentence.product, product_iterator);
+
+				if (ALG_NORMAL == true)
+					alg_normal_set(msentence.multiplier, &mult_array);
+			}
 
-		for (; msentence.multiplicand <= multiplicand_max; msentence.multiplicand += BASE - 1) {
-			int result = 0;
+			for (; msentence.multiplicand <= multiplicand_max; msentence.multiplicand += BASE - 1) {
+				int result = 0;
+
+				if (use_bits) {
+					alg_bits_check(&bt_data, msentence.multiplicand, msentence.product, &result);
+				} else if (use_swar) {
+					alg_swar_check(&sw_data, &result);
+				} else {
+					alg_cache_check(&ag_data, &result);
+					if (ALG_NORMAL == true)
+						alg_normal_check(mult_array, msentence.multiplicand, msentence.product, &result);
+				}
 
-			alg_cache_check(&ag_data, &result);
-			if (ALG_NORMAL == true)
-				alg_normal_check(mult_array, msentence.multiplicand, msentence.product, &result);
-
-			if (result && (mult_zero || notrailingzero(msentence.multiplicand))) {
-				switch (store_to) {
-					case msentence_e:
-						msentence_count++;
-						llmsentence_add(&(ll_msentence), msentence);
-						if (msentence_count > LLMSENTENCE_LIMIT) {
-							msentence_to_vampire(args, &ll_msentence, &ll_vampire);
-							msentence_count = 0;
-							llmsentence_new(&ll_msentence, NULL);
-						}
-						break;
-					case vampire_e:
-						vargs_iterate_local_count(args);
-						vargs_print_results(args->stdout_mtx, msentence.product, msentence.multiplier, msentence.multiplicand);
-						llvamp_add(&(ll_vampire), msentence.product);
-						break;
-					default:
-						break;
+				if (result && (mult_zero || notrailingzero(msentence.multiplicand))) {
+					switch (store_to) {
+						case msentence_e:
+							msentence_count++;
+							llmsentence_add(&(ll_msentence), msentence);
+							if (msentence_count > LLMSENTENCE_LIMIT) {
+								msentence_to_vampire(args, &ll_msentence, &ll_vampire);
+								msentence_count = 0;
+								llmsentence_new(&ll_msentence, NULL);
+							}
+							break;
+						case vampire_e:
+							vargs_iterate_local_count(args);
+							vargs_print_results(args->stdout_mtx, msentence.product, msentence.multiplier, msentence.multiplicand);
+							llvamp_add(&(ll_vampire), msentence.product);
+							break;
+						default:
+							break;
+					}
 				}
+				if (use_swar)
+					alg_swar_iterate_all(&sw_data);
+				else if (!use_bits)
+					alg_cache_iterate_all(&ag_data);
+				msentence.product += product_iterator;
 			}
-			alg_cache_iterate_all(&ag_data);
-			msentence.product += product_iterator;
 		}
 	}
 
@@ -519,7 +1166,7 @@ void vampire(vamp_t min, vamp_t max, struct vargs *args, fang_t fmax)
 	if (ll_msentence != NULL)
 		msentence_to_vampire(args, &ll_msentence, &ll_vampire);
 
-	array_new(&(args->result), &ll_vampire, &(args->local_count));
+	array_new(&(args->result), &ll_vampire);
 
 	llvamp_free(ll_vampire);
 	return;
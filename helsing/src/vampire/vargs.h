@@ -7,27 +7,76 @@
 #define HELSING_VARGS_H
 
 #include <threads.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 
 #include "configuration_adv.h"
 #include "cache.h"
 #include "array.h"
+#include "alphabet.h"
 
 #if FANG_PRINT
 #include <stdio.h>
 #endif
 
+/*
+ * residue:
+ *
+ * Indexed by multiplier % (BASE - 1).
+ */
+
+struct residue
+{
+	bool admissible[BASE];
+	digit_t multiplicand[BASE];
+};
+
+/*
+ * multipliers:
+ *
+ * 	The multipliers [min, max] that a running vampire() call hasn't reached
+ * yet. vampire() claims them from the top, MULTIPLIER_BLOCK at a time, so
+ * that an idle thread can take the bottom half off its hands.
+ *
+ * 	vampire() may also stop early for the task checkpoint, see
+ * TASK_CHECKPOINT. The multipliers it didn't reach are then left in
+ * [min, max]. The writer asks for that with yield, which is all vampire()
+ * checks between blocks.
+ */
+
+#define MULTIPLIER_BLOCK 64
+
+struct multipliers
+{
+	mtx_t mtx;
+	fang_t min;
+	fang_t max;
+	bool active; // false once the last block has been claimed
+	bool yielded; // vampire() stopped before max, see multipliers_yielded
+	bool stop; // Stop every vampire() call at the next block, see taskboard_stop
+	atomic_bool yield; // Stop the running vampire() call at the next block, see taskboard_yield
+};
+
+void multipliers_init(struct multipliers *ptr);
+void multipliers_destroy(struct multipliers *ptr);
+bool multipliers_split(struct multipliers *ptr, fang_t *min, fang_t *max);
+bool multipliers_yielded(struct multipliers *ptr, fang_t *max);
+
 struct vargs /* Vampire arguments */
 {
 	struct cache *digptr;
+	const struct alphabet *alphabet;
+	struct residue residue;
+	struct multipliers *multipliers;
 	struct array *result;
 	vamp_t local_count[COUNT_ARRAY_SIZE];
 	mtx_t *stdout_mtx;
 };
 
-void vargs_new(struct vargs **ptr, struct cache *digptr, mtx_t *stdout_mtx);
+void vargs_new(struct vargs **ptr, struct cache *digptr, const struct alphabet *alphabet, struct multipliers *multipliers, mtx_t *stdout_mtx);
 void vargs_free(struct vargs *args);
 void vargs_reset(struct vargs *args);
-void vampire(vamp_t min, vamp_t max, struct vargs *args, fang_t fmax);
+void vampire(vamp_t min, vamp_t max, fang_t fmin, fang_t fmax, struct vargs *args);
 
 #if FANG_PAIR_OUTPUTS
 static inline void vargs_iterate_local_count(struct vargs *ptr)
@@ -95,4 +144,56 @@ static inline void alg_cache_iterate_all(ATTR_UNUSED struct alg_cache *ptr)
 }
 #endif /* !ALG_CACHE */
 
+#if !(ALG_SWAR)
+struct alg_swar
+{
+	int unused;
+};
+static inline void alg_swar_init(
+	ATTR_UNUSED struct alg_swar *ptr,
+	ATTR_UNUSED length_t lenmax)
+{
+}
+static inline void alg_swar_set(
+	ATTR_UNUSED struct alg_swar *ptr,
+	ATTR_UNUSED fang_t multiplier,
+	ATTR_UNUSED fang_t multiplicand,
+	ATTR_UNUSED vamp_t product,
+	ATTR_UNUSED vamp_t product_iterator)
+{
+}
+static inline void alg_swar_check(
+	ATTR_UNUSED struct alg_swar *ptr,
+	ATTR_UNUSED int *result)
+{
+}
+static inline void alg_swar_iterate_all(ATTR_UNUSED struct alg_swar *ptr)
+{
+}
+#endif /* !ALG_SWAR */
+
+#if !(ALG_BITS_ACTIVE)
+struct alg_bits
+{
+	int unused;
+};
+static inline void alg_bits_init(
+	ATTR_UNUSED struct alg_bits *ptr,
+	ATTR_UNUSED length_t lenmax)
+{
+}
+static inline void alg_bits_set(
+	ATTR_UNUSED struct alg_bits *ptr,
+	ATTR_UNUSED fang_t multiplier)
+{
+}
+static inline void alg_bits_check(
+	ATTR_UNUSED struct alg_bits *ptr,
+	ATTR_UNUSED fang_t multiplicand,
+	ATTR_UNUSED vamp_t product,
+	ATTR_UNUSED int *result)
+{
+}
+#endif /* !ALG_BITS_ACTIVE */
+
 #endif /* HELSING_VARGS_H */
@@ -0,0 +1,76 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+# Writes the results with --format binary, decodes them with --decode and
+# checks that they're printed the same as with text output, for a couple of
+# builds. The output of a resumed run is appended to the same stream.
+
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+n=10
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+cp configuration.h configuration.backup
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv configuration.backup configuration.h
+	exit $1
+}
+
+trap 'cleanup 1' SIGINT
+
+fail=0
+function check()
+{
+	if (( $1 != 0 )) || ! cmp -s "$tempdir/out" "$tempdir/expected"; then
+		echo "FAIL: $2"
+		fail=1
+	else
+		echo "ok: $2"
+	fi
+}
+
+while read -r config; do
+	cp configuration.backup configuration.h
+	"$selfdir/../../scripts/configuration/set_cache.sh"
+	"$selfdir/../../scripts/configuration/set.sh" BASE 10
+	for setting in $config; do
+		"$selfdir/../../scripts/configuration/set.sh" ${setting%=*} ${setting#*=}
+	done
+	make clean > /dev/null 2>&1
+	make -j4 OPTIMIZE=-O2 > /dev/null 2>&1 || cleanup 1
+
+	./helsing -n $n > "$tempdir/expected" 2> /dev/null
+	./helsing -n $n -t 3 --format binary > "$tempdir/binary" 2> /dev/null
+	./helsing --decode "$tempdir/binary" > "$tempdir/out" 2> /dev/null
+	check $? "$config"
+	./helsing --decode - < "$tempdir/binary" > "$tempdir/out" 2> /dev/null
+	check $? "$config, from stdin"
+
+	# Check up to 999999 first, then resume the rest of -l 10 -u 9999999999.
+	rm -f "$tempdir/checkpoint"
+	./helsing -l 10 -u 999999 -c "$tempdir/checkpoint" > "$tempdir/expected" 2> /dev/null
+	sed -i "1s/.*/10 9999999999/" "$tempdir/checkpoint"
+	./helsing -c "$tempdir/checkpoint" >> "$tempdir/expected" 2> /dev/null
+
+	rm -f "$tempdir/checkpoint"
+	./helsing -l 10 -u 999999 -c "$tempdir/checkpoint" --format binary > "$tempdir/binary" 2> /dev/null
+	sed -i "1s/.*/10 9999999999/" "$tempdir/checkpoint"
+	./helsing -c "$tempdir/checkpoint" --format binary >> "$tempdir/binary" 2> /dev/null
+	./helsing --decode "$tempdir/binary" > "$tempdir/out" 2> /dev/null
+	check $? "$config, resumed and appended"
+done << EOF2
+VAMPIRE_PRINT=true
+VAMPIRE_PRINT=true VAMPIRE_HASH=true
+VAMPIRE_INDEX=true VAMPIRE_PRINT=true VAMPIRE_INTEGRAL=true
+VAMPIRE_PRINT=true MIN_FANG_PAIRS=1 MAX_FANG_PAIRS=3
+VAMPIRE_INTEGRAL=true MIN_FANG_PAIRS=2 MAX_FANG_PAIRS=2
+EOF2
+
+cleanup $fail
@@ -0,0 +1,81 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+# Resumes checkpoints that weren't compacted, cut at different lines, and
+# checks that they end up the same as the checkpoint of a run from scratch.
+
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+cp configuration.h configuration.backup
+"$selfdir/../../scripts/configuration/set_cache.sh"
+"$selfdir/../../scripts/configuration/set.sh" BASE 10
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_PRINT false
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_HASH false
+"$selfdir/../../scripts/configuration/set.sh" MIN_FANG_PAIRS 1
+"$selfdir/../../scripts/configuration/set.sh" MAX_FANG_PAIRS 1
+"$selfdir/../../scripts/configuration/set.sh" CHECKPOINT_HISTORY true
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv configuration.backup configuration.h
+	exit $1
+}
+
+trap 'cleanup 1' SIGINT
+
+make clean > /dev/null 2>&1
+make -j4 OPTIMIZE=-O2 > /dev/null 2>&1 || cleanup 1
+
+# A checkpoint written before the lines were compacted, one line per task.
+cat > "$tempdir/old" << EOF
+10 99999999
+21 0
+33 0
+45 0
+57 0
+69 0
+81 0
+2466 6
+3933 6
+5400 6
+6867 6
+8334 7
+9801 7
+249666 78
+399333 115
+549000 134
+698667 141
+848334 154
+998001 155
+24996666 1603
+39993333 2360
+54990000 2825
+69986667 3156
+84983334 3331
+99980001 3383
+EOF
+
+./helsing -l 10 -u 99999999 -c "$tempdir/fresh" > /dev/null 2>&1
+
+fail=0
+for cut in 21 81 2466 9801 549000 998001 54990000; do
+	sed "/^$cut /q" "$tempdir/old" > "$tempdir/resumed"
+	./helsing -c "$tempdir/resumed" -t 2 > /dev/null 2>&1
+	rc=$?
+	# Resuming a checkpoint that's complete must work too.
+	./helsing -c "$tempdir/resumed" > /dev/null 2>&1
+	if (( $rc != 0 || $? != 0 )) || ! cmp -s "$tempdir/resumed" "$tempdir/fresh"; then
+		echo "FAIL: resumed after $cut"
+		fail=1
+	else
+		echo "ok: resumed after $cut"
+	fi
+done
+
+cleanup $fail
@@ -0,0 +1,81 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+# Searches with -d, a digit alphabet or multiset, and checks that the
+# results are the ones of a full search that are made of these digits.
+
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+n=8
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+cp configuration.h configuration.backup
+"$selfdir/../../scripts/configuration/set_cache.sh"
+"$selfdir/../../scripts/configuration/set.sh" BASE 10
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_PRINT true
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv configuration.backup configuration.h
+	exit $1
+}
+
+trap 'cleanup 1' SIGINT
+
+make clean > /dev/null 2>&1
+make -j4 OPTIMIZE=-O2 > /dev/null 2>&1 || cleanup 1
+
+./helsing -n $n > "$tempdir/full" 2> /dev/null
+
+# The digits of a number in ascending order.
+sorted_digits='function sorted_digits(s,    d, c, t, out) {
+	for (d = 0; d < 10; d++) {
+		t = s
+		for (c = gsub(d, "", t); c > 0; c--)
+			out = out d
+	}
+	return out
+}'
+
+fail=0
+function check()
+{
+	if (( $1 != 0 )) || ! cmp -s "$tempdir/out" "$tempdir/expected"; then
+		echo "FAIL: $2"
+		fail=1
+	else
+		echo "ok: $2"
+	fi
+}
+
+for digits in 123456 123456789 012345 0125; do
+	grep -E "^[$digits]+ ?$" "$tempdir/full" > "$tempdir/expected"
+	./helsing -n $n -d $digits -t 2 > "$tempdir/out" 2> /dev/null
+	check $? "-d $digits"
+done
+
+for digits in 98764321 01234579 12345678 00112458; do
+	awk -v digits="$digits" "$sorted_digits"' sorted_digits($1) == sorted_digits(digits)' "$tempdir/full" > "$tempdir/expected"
+	./helsing -n $n -d =$digits -t 2 > "$tempdir/out" 2> /dev/null
+	check $? "-d =$digits"
+done
+
+# The digits are kept in the checkpoint.
+./helsing -n $n -d =12345678 -c "$tempdir/checkpoint" > /dev/null 2>&1
+if [[ "$(head -n 1 "$tempdir/checkpoint")" != "10000000 99999999 =12345678" ]]; then
+	echo "FAIL: the digit multiset isn't in the checkpoint"
+	fail=1
+fi
+if ./helsing -c "$tempdir/checkpoint" -d 12345678 2>&1 | grep -q "differs from -d"; then
+	echo "ok: resuming with other digits"
+else
+	echo "FAIL: resuming with other digits"
+	fail=1
+fi
+
+cleanup $fail
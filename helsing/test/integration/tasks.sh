@@ -0,0 +1,84 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+# Stops a run again and again, with SIGTERM or SIGKILL, and resumes it from
+# the checkpoint and its task checkpoint, until it's complete. The last line
+# of the checkpoint has to be the same as the one of a run from scratch.
+#
+# The interval is at the top of its digit length, where tasks get cheaper
+# the further they are, so with six threads some tasks are running when the
+# run stops, and some complete out of order while an earlier one is still
+# running. Half of the runs have -w 1K, which moves the results of the
+# latter to the spill file. All of the task states of the task checkpoint
+# get saved and loaded: done, running and redo.
+
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+min=600000000000
+max=999999999999
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+cp configuration.h configuration.backup
+"$selfdir/../../scripts/configuration/set_cache.sh"
+"$selfdir/../../scripts/configuration/set.sh" BASE 10
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_PRINT false
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_HASH true
+"$selfdir/../../scripts/configuration/set.sh" TASK_CHECKPOINT 1
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv configuration.backup configuration.h
+	exit $1
+}
+
+trap 'cleanup 1' SIGINT
+
+make clean > /dev/null 2>&1
+make -j4 OPTIMIZE=-O2 > /dev/null 2>&1 || cleanup 1
+
+./helsing -l $min -u $max -c "$tempdir/fresh" > /dev/null 2>&1
+
+fail=0
+saved=0
+args="-l $min -u $max -s 20000000000"
+for round in {1..20}; do
+	window=""
+	if (( round % 4 >= 2 )); then
+		window="-w 1K"
+	fi
+	./helsing $args -t 6 $window -c "$tempdir/resumed" > /dev/null 2>&1 &
+	pid=$!
+	args=""
+	sleep 2
+	if ! kill -0 $pid 2> /dev/null; then
+		wait $pid
+		break
+	fi
+	if (( round % 2 == 0 )); then
+		{ kill -KILL $pid; wait $pid; } 2> /dev/null
+	else
+		kill -TERM $pid
+		wait $pid
+	fi
+	if [[ -s "$tempdir/resumed.tasks" ]]; then
+		saved=1
+	fi
+done
+./helsing -c "$tempdir/resumed" > /dev/null 2>&1 || fail=1
+
+if (( saved == 0 )); then
+	echo "FAIL: no task checkpoint was saved"
+	fail=1
+elif (( fail != 0 )) || [[ "$(tail -n 1 "$tempdir/resumed")" != "$(tail -n 1 "$tempdir/fresh")" ]]; then
+	echo "FAIL: resumed with the task checkpoint"
+	fail=1
+else
+	echo "ok: resumed with the task checkpoint"
+fi
+
+cleanup $fail
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+# Changes the number of threads with --threads-file while running, and
+# checks that the results are printed the same as with a fixed number.
+
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+n=10
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+cp configuration.h configuration.backup
+"$selfdir/../../scripts/configuration/set_cache.sh"
+"$selfdir/../../scripts/configuration/set.sh" BASE 10
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_PRINT true
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv configuration.backup configuration.h
+	exit $1
+}
+
+trap 'cleanup 1' SIGINT
+
+make clean > /dev/null 2>&1
+make -j4 OPTIMIZE=-O2 > /dev/null 2>&1 || cleanup 1
+
+./helsing -n $n > "$tempdir/expected" 2> /dev/null
+
+fail=0
+function check()
+{
+	if (( $1 != 0 )) || ! cmp -s "$tempdir/out" "$tempdir/expected"; then
+		echo "FAIL: $2"
+		fail=1
+	else
+		echo "ok: $2"
+	fi
+}
+
+# Start with 1 of 4 threads, then go up to 4, down to 2 and up to 3.
+echo 1 > "$tempdir/threads"
+./helsing -n $n -t 4 -s 10000000 --threads-file "$tempdir/threads" > "$tempdir/out" 2> "$tempdir/err" &
+pid=$!
+for threads in 4 2 3; do
+	sleep 1.5
+	echo $threads > "$tempdir/threads"
+done
+wait $pid
+check $? "1, 4, 2 and 3 of 4 threads"
+
+# A file that's missing or unreadable changes nothing.
+rm -f "$tempdir/threads"
+./helsing -n $n -t 2 --threads-file "$tempdir/threads" > "$tempdir/out" 2> /dev/null
+check $? "missing threads file"
+echo "many" > "$tempdir/threads"
+./helsing -n $n -t 2 --threads-file "$tempdir/threads" > "$tempdir/out" 2> /dev/null
+check $? "unreadable threads file"
+
+# The file can't ask for more threads than were started.
+echo 100000 > "$tempdir/threads"
+./helsing -n $n -t 2 --threads-file "$tempdir/threads" > "$tempdir/out" 2> "$tempdir/err"
+check $? "more threads than were started"
+if ! grep -q "only .* were started" "$tempdir/err"; then
+	echo "FAIL: no warning for more threads than were started"
+	fail=1
+fi
+
+cleanup $fail
@@ -0,0 +1,54 @@
+#!/bin/bash
+
+: '
+SPDX-License-Identifier: BSD-3-Clause
+Copyright (c) 2026 Pierro Zachareas
+'
+
+# Runs with different reorder windows and memory limits, and checks that
+# the results are printed the same as with the defaults.
+
+selfdir="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+n=10
+
+tempdir=$(mktemp -d) && trap 'rm -rf "$tempdir"' EXIT || exit
+cp configuration.h configuration.backup
+"$selfdir/../../scripts/configuration/set_cache.sh"
+"$selfdir/../../scripts/configuration/set.sh" BASE 10
+"$selfdir/../../scripts/configuration/set.sh" VAMPIRE_PRINT true
+
+function cleanup()
+{
+	make clean > /dev/null 2>&1
+	mv configuration.backup configuration.h
+	exit $1
+}
+
+trap 'cleanup 1' SIGINT
+
+make clean > /dev/null 2>&1
+make -j4 OPTIMIZE=-O2 > /dev/null 2>&1 || cleanup 1
+
+./helsing -n $n > "$tempdir/expected" 2> /dev/null
+
+fail=0
+while read -r args; do
+	./helsing -n $n $args > "$tempdir/out" 2> /dev/null
+	if (( $? != 0 )) || ! cmp -s "$tempdir/out" "$tempdir/expected"; then
+		echo "FAIL: -n $n $args"
+		fail=1
+	else
+		echo "ok: -n $n $args"
+	fi
+done << EOF
+-w 1
+-w 2 -t 3
+-w 1K
+-w 1K -t 3 -s 10000000
+--max-memory 1M
+--max-memory 64K -t 3
+--max-memory 64K -w 5 -t 3
+EOF
+
+cleanup $fail